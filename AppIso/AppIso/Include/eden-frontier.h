@@ -0,0 +1,88 @@
+#pragma once
+
+#include "graph.h"
+#include "weighted-sampler.h"
+
+// Frontier of an Eden growth on a GraphPoisson
+// A node is in the frontier if it is assigned and has at least one free (not yet assigned) neighbour
+// We keep for each frontier node the number of its free neighbours, so that a node leaves the frontier as soon as its last free neighbour is assigned
+// Assigning a node only updates its own neighbours, the frontier never contains dead nodes and sampling never needs to retry
+class EdenFrontier
+{
+protected:
+    QVector<bool> free;             //!< nodes the growth can still reach
+    QVector<int> freeNeighbours;    //!< number of free neighbours of each frontier node, -1 for nodes which are not part of the growth
+    WeightedSampler frontier;       //!< frontier nodes weighted by their probability to be chosen
+
+public:
+    EdenFrontier(int = 0);
+
+    void SetFree(int);
+    void AddBorder(const GraphPoisson&, int, double);
+    void Assign(const GraphPoisson&, int, double);
+
+    bool IsFree(int) const;
+    bool Contains(int) const;
+    int FreeNeighbours(int) const;
+    int FreeNeighbour(const GraphPoisson&, int, int) const;
+
+    int Size() const;
+    bool IsEmpty() const;
+    double Total() const;
+    int Sample(double) const;
+
+protected:
+    int CountFreeNeighbours(const GraphPoisson&, int) const;
+};
+
+/*!
+\brief Mark a node as reachable by the growth (should be done before adding borders)
+*/
+inline void EdenFrontier::SetFree(int i)
+{
+    free[i] = true;
+}
+
+inline bool EdenFrontier::IsFree(int i) const
+{
+    return free[i];
+}
+
+/*!
+\brief Return true if the node is currently in the frontier
+*/
+inline bool EdenFrontier::Contains(int i) const
+{
+    return frontier.Contains(i);
+}
+
+/*!
+\brief Number of free neighbours of a frontier node
+*/
+inline int EdenFrontier::FreeNeighbours(int i) const
+{
+    return Math::Max(0, freeNeighbours[i]);
+}
+
+inline int EdenFrontier::Size() const
+{
+    return frontier.Size();
+}
+
+inline bool EdenFrontier::IsEmpty() const
+{
+    return frontier.IsEmpty();
+}
+
+inline double EdenFrontier::Total() const
+{
+    return frontier.Total();
+}
+
+/*!
+\brief Pick a frontier node, see WeightedSampler::Sample
+*/
+inline int EdenFrontier::Sample(double u) const
+{
+    return frontier.Sample(u);
+}
@@ -4,11 +4,55 @@
 #include "tin.h"
 #include "histogramd.h"
 
+#include <limits>
+
+// Intervalle de voisins d'un sommet dans l'adjacence CSR du graphe, s'utilise comme un conteneur : for (int n : g.Neighbours(i))
+// Ne fait que pointer dans le tableau partag par le graphe, aucune allocation
+class NeighbourRange
+{
+protected:
+	const int* first;
+	const int* last;
+
+public:
+	NeighbourRange(const int* first, const int* last) : first(first), last(last) {};
+
+	const int* begin() const { return first; }
+	const int* end() const { return last; }
+	int Size() const { return int(last - first); }
+	bool IsEmpty() const { return first == last; }
+	int operator[](int k) const { return first[k]; }
+	bool Contains(int n) const { return std::find(first, last, n) != last; }
+};
+
+// Adjacence des sommets de `topology` au format CSR (compressed sparse row) :
+// les voisins du sommet i sont neighbours[offsets[i]], ..., neighbours[offsets[i + 1] - 1]
+struct GraphAdjacency
+{
+	QVector<int> offsets;
+	QVector<int> neighbours;
+};
+
+// Grille uniforme de localisation des triangles de `topology`, chaque case contient (au format CSR) les triangles dont la bote englobante la touche
+// Les triangles d'une case sont rangs par indice croissant
+struct TriangleGrid
+{
+	Vector2 origin;
+	double cell = 1.0;
+	int nx = 0;
+	int ny = 0;
+	QVector<int> offsets;
+	QVector<int> triangles;
+
+	int CellX(double x) const { return Math::Min(nx - 1, Math::Max(0, int(Math::Floor((x - origin[0]) / cell)))); }
+	int CellY(double y) const { return Math::Min(ny - 1, Math::Max(0, int(Math::Floor((y - origin[1]) / cell)))); }
+};
+
 /*
  * Graphe  l'intrieur d'un masque donn, reprsentant l o il y a du terrain et l o il y a de la "mer".
  * La gnration est faite comme ceci :
  * - On tend la box du masque d'une largeur de 4 * radius
- * - On poissonnise toute cette zone tendu = topologyExt
+ * - On poissonnise cette zone tendu = topologyExt, en sautant les tuiles du sampling loin des terres (voir Misc::DelaunayPointsInBox)
  * - On ne garde que les points  l'intrieur du masque = topology (l'endroit o il y a du terrain)
  * 
  * Un point du graphe est considr comme une bordure (ie proche de la mer) si
@@ -43,12 +87,14 @@ protected:
 	QSharedPointer<Tin2> topologyExt; // tous les points et triangles dans la box tendue de 4*r
 	QVector<int> topoToExt;			  // comment passer d'un indice de `topology` vers `topologyExt`
 	QVector<int> extToTopo;			  // l'inverse (= -1 lorsque le point n'est pas dans `topology`)
+	QSharedPointer<GraphAdjacency> adjacency; // voisins de chaque sommet, calculs une seule fois  la construction
+	QSharedPointer<TriangleGrid> locator;	  // pour retrouver rapidement le triangle contenant un point
 	QVector<double> values;
 
 	friend class ArticleUtils;
 
 public:
-	GraphPoisson() : radius(0), topology(nullptr), topologyExt(nullptr), values({}) {};
+	GraphPoisson() : radius(0), topology(nullptr), topologyExt(nullptr), adjacency(nullptr), locator(nullptr), values({}) {};
 	GraphPoisson(const ScalarField2&, double, const double& = 0);
 	//GraphPoisson(const ScalarField2&, double, const ScalarField2&);
 	//GraphPoisson(const GraphPoisson&);
@@ -71,7 +117,7 @@ public:
 	double Radius() const;
 	int Size() const;
 
-	QSet<int> Neighbours(int) const;
+	NeighbourRange Neighbours(int) const;
 	bool IsBorder(int) const;
 	Vector2 Position(int) const;
 	
@@ -81,6 +127,7 @@ public:
 
 	double SeaLevel() const;
 	Polygons2 ContourLines(double h) const;
+	QVector<Polygons2> ContourLines(const QVector<double>&) const;
 
 	struct DisplayOptions
 	{
@@ -128,6 +175,12 @@ public:
 
 protected:
 	bool ExteriorPointInsideMask(int vi) const;
+	QVector<double> ExtendedValues(double, double) const;
+	Polygons2 MarchingTriangles(const QVector<double>&, double, const QVector<int>&, QVector<int>&) const;
+	void BuildAdjacency();
+	void BuildLocator();
+	int FindTriangle(const Vector2&) const;
+	double Interpolate(int, const Vector2&) const;
 };
 
 inline double GraphPoisson::operator[](int i) const
@@ -166,20 +219,11 @@ inline int GraphPoisson::Size() const
 	return values.size();
 }
 
-inline QSet<int> GraphPoisson::Neighbours(int i) const
+// Voisins du sommet i, sans doublons (voir BuildAdjacency)
+inline NeighbourRange GraphPoisson::Neighbours(int i) const
 {
-	QSet<int> neighs;
-	
-	// TODO: On utilise topologyExt car elle nous permet d'viter les bugs de points seuls et ceux des points d'articulation qui ne sont pas pris en compte dans le TIN.
-	int ei = topoToExt[i];
-	for (int ni : topologyExt->VertexNeighboursVertices(ei))
-	{
-		int eni = extToTopo[ni];
-		if (eni != -1)
-			neighs.insert(eni);
-	}
-
-	return neighs;
+	const int* n = adjacency->neighbours.constData();
+	return NeighbourRange(n + adjacency->offsets[i], n + adjacency->offsets[i + 1]);
 }
 
 inline bool GraphPoisson::IsBorder(int i) const
@@ -213,4 +257,57 @@ inline bool GraphPoisson::IsBorder(int i) const
 inline Vector2 GraphPoisson::Position(int i) const
 {
 	return topology->Vertex(i);
-}
\ No newline at end of file
+}
+
+/*
+ * Une valeur par sommet d'un GraphPoisson, sans copie du graphe (ni masque, ni pointeurs de topologie) : juste un tableau typ
+ * Les gnrateurs gardent leur tat de travail (compteurs d'tapes, probas, ...) dans des colonnes, et ne crent un GraphPoisson
+ * qu' la fin avec ToGraph, sur la topologie partage. A 1M de particules, un int ou un float prend 2 fois moins qu'un double.
+ */
+template<typename T>
+class GraphColumn
+{
+protected:
+	QVector<T> values;
+	T unset = T();			//!< Valeur des sommets pas encore assigns (les types entiers n'ont pas d'infini), rendue par ToGraph
+
+public:
+	//! empty
+	GraphColumn() {};
+	GraphColumn(const GraphPoisson& g, const T& unset) : values(g.Size(), unset), unset(unset) {};
+	GraphColumn(const GraphPoisson&, const T&, double);
+
+	T operator[](int i) const { return values[i]; }
+	T& operator[](int i) { return values[i]; }
+	int Size() const { return values.size(); }
+	void Fill(const T& v) { values.fill(v); }
+
+	GraphPoisson ToGraph(const GraphPoisson&, double = Math::Infinity) const;
+};
+
+/*
+ * Copie (et conversion) des valeurs de g
+ *
+ * \param unset Valeur de la colonne pour les sommets pas encore assigns
+ * \param unsetValue La valeur de ces sommets dans g
+ */
+template<typename T>
+inline GraphColumn<T>::GraphColumn(const GraphPoisson& g, const T& unset, double unsetValue) : values(g.Size()), unset(unset)
+{
+	for (int i = 0; i < g.Size(); ++i)
+		values[i] = g[i] == unsetValue ? unset : T(g[i]);
+}
+
+/*
+ * Graphe avec la topologie de g et les valeurs de la colonne
+ *
+ * \param unsetValue La valeur donne dans le graphe aux sommets pas encore assigns (ceux  la valeur unset de la colonne)
+ */
+template<typename T>
+inline GraphPoisson GraphColumn<T>::ToGraph(const GraphPoisson& g, double unsetValue) const
+{
+	GraphPoisson graph(g, 0);
+	for (int i = 0; i < values.size(); ++i)
+		graph[i] = values[i] == unset ? unsetValue : double(values[i]);
+	return graph;
+}
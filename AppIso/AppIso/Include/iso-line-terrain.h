@@ -24,15 +24,20 @@ public:
 	double InterpolateH(const Vector2& p, double distToFade = 0.0) const;
 	HeightField InterpolateField(const Box2& b, int x, int y, double distToFade = 0.0) const;
 	HeightField InterpolateField(int x, int y, double distToFade = 0.0) const;
+	bool UpdateInterpolateField(HeightField& hf, const IsoLines& previous, double distToFade = 0.0) const;
+	HeightField InterpolateFieldDT(const Box2& b, int x, int y, double distToFade = 0.0) const;
+	HeightField InterpolateFieldDT(int x, int y, double distToFade = 0.0) const;
 
 	double StairsH(const Vector2& p) const;
 	HeightField StairsField(const Box2& b, int x, int y) const;
 	HeightField StairsField(int x, int y) const;
+	bool UpdateStairsField(HeightField& hf, const IsoLines& previous) const;
 
 	HeightField SmoothStairsField(const Box2& b, int x, int y, int nsmooth = 5) const;
 	HeightField SmoothStairsField(int x, int y, int nsmooth = 5) const;
 
 	HeightField HeatField(const Box2& b, int x, int y, bool = true) const;
+	HeightField HeatField(const Box2& b, int x, int y, const HeightField& previous, bool = true) const;
 	HeightField HeatField(int x, int y, bool = true) const;
 
 	QVector<Mesh> GetMesh(const Box2& box) const;
@@ -48,6 +53,31 @@ public:
 	IsoLines GetIsoLines() const { return isoLines; }
 
 protected:
+	//! Everything InterpolateH needs about the isos, gathered once for a whole field so that pixels can be computed in parallel without copying isos out of IsoLines
+	struct InterpolationCache
+	{
+		QVector<IsoLinePoly> isos;		//!< Copies of the isos sharing their edge index, for distance and inside queries
+		QVector<double> h;				//!< Height of each iso
+		QVector<int> parents;
+		QVector<QVector<int>> children;
+		QVector<int> roots;
+		QVector<bool> growing;			//!< See IsoLines::isGrowing
+		QVector<Vector2> centers;
+	};
+	QSharedPointer<const InterpolationCache> interpolationCache;	//!< See Cache(), built by the constructor since isoLines never change afterwards
+
+	const InterpolationCache& Cache() const;
+	InterpolationCache BuildInterpolationCache() const;
+	double IsoDistance(const InterpolationCache&, int, const Vector2&, double) const;
+	int ParentIso(const InterpolationCache&, const Vector2&, int) const;
+	double InterpolateH(const InterpolationCache&, const Vector2&, int, double) const;
+	double OutsideH(const InterpolationCache&, double, double) const;
+	double BlendH(const InterpolationCache&, const Vector2&, int, double, int, double) const;
+	static bool PixelRange(const HeightField&, const Box2&, int&, int&, int&, int&);
+
+	static void RasterizeBoundary(const InterpolationCache&, int, QVector<double>&, QVector<int>&, int, int, int, int, const Vector2&, double, double);
+	static void DistanceTransform(QVector<double>&, QVector<int>&, int, int, double, double);
+	static void DistanceTransform(const double*, const int*, double*, int*, int, double, int*, double*);
 };
 
 inline IsoLineTerrain IsoLineTerrain::TestSimpleTriangles()
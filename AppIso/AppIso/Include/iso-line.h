@@ -3,11 +3,27 @@
 #include "heightfield.h"
 #include "graph.h"
 #include "histogramd.h"
+#include "segment-bvh.h"
+
+#include <atomic>
+#include <memory>
 
 class IsoLinePoly : public Polygon2
 {
 protected:
 	double h; //<! Height of the iso
+
+	//! Box and edge hierarchy of the polygon, built when first needed and shared between copies
+	//! It keeps a reference on the vertices it was built from: any modification of q detaches q from it, which is how we know it is out of date
+	//! The pointer is atomic so that a polygon can be queried (and its index built) from several threads
+	struct EdgeIndex
+	{
+		QVector<Vector2> vertices;
+		Box2 box;
+		SegmentBVH bvh;
+	};
+	mutable std::atomic<std::shared_ptr<const EdgeIndex>> edgeIndex;
+
 public:
 	enum IntersectType { INTERSECT, INSIDE, CONTAINS, INDEPENDENT };
 public:
@@ -15,6 +31,8 @@ public:
 	IsoLinePoly();
 	IsoLinePoly(const QVector<Vector2>&, double = 0.0);
 	IsoLinePoly(const Polygon2&, double = 0.0);
+	IsoLinePoly(const IsoLinePoly&);
+	IsoLinePoly& operator=(const IsoLinePoly&);
 
 	double H() const;
 	void SetH(double h);
@@ -36,8 +54,15 @@ public:
 	IsoLinePoly DisplacementTowardCurve(const PointCurve2&, double, double, double = 2) const;
 
 	IntersectType RelationWith(const Polygon2&) const;
+	void BuildEdgeIndex() const;
+	bool InsideIndexed(const Vector2&) const;
+	double DistanceIndexed(const Vector2&, double = Math::Infinity) const;
+	double SignedIndexed(const Vector2&) const;
 	Vector2 VertexNormal(int) const;
 	QVector<int> EarClip2() const;
+
+protected:
+	const EdgeIndex& Index() const;
 };
 
 /**
@@ -54,6 +79,21 @@ protected:
 
 	bool simple;		//<! If true, we only keep isolines without trying to know their parents and children, when this is true the Append function is really quicker
 
+	//! Grid over the isolines answering ComputeParentIso(const Vector2&), built by BuildPointIndex
+	//! Like the edge index of IsoLinePoly, it keeps a reference on the isolines it was built from: any modification of isos detaches isos from it, which is how we know it is out of date
+	struct PointIndex
+	{
+		QVector<IsoLinePoly> isos;
+		Vector2 origin;
+		double cell;
+		int nx, ny;
+		QVector<int> base;			//!< innermost iso containing the whole cell, -1 if none
+		QVector<int> depth;			//!< depth of each iso in the hierarchy (0 for the roots)
+		QVector<int> offsets;		//!< isos whose boundary may cross cell c are boundaries[offsets[c], offsets[c + 1])
+		QVector<int> boundaries;	//!< for each cell, sorted from the deepest iso to the highest
+	};
+	mutable QSharedPointer<const PointIndex> pointIndex;
+
 public:
 	//! empty
 	IsoLines(bool simple = false) : simple(simple) {};
@@ -81,10 +121,14 @@ public:
 	// Moves
 	IsoLines Centered() const;
 
+	void BuildEdgeIndices() const;
+	void BuildPointIndex(int = 256) const;
 	int ComputeParentIso(const Vector2&) const;
 	bool ComputeParentIso(const Polygon2&, int&) const;
+	QVector<int> ComputeParentIsos(const QVector<double>&, const QVector<double>&) const;
 	bool Append(const Polygon2&, double = 0);
 	bool Append(const IsoLinePoly&);
+	QVector<bool> AppendAll(const QVector<IsoLinePoly>&);
 	void Remove(int, bool = false);
 	void Remove(const QSet<int>&, bool);
 	void Remove(const QSet<int>&);
@@ -118,6 +162,7 @@ public:
 	bool Inside(const Vector2&) const;
 
 	// Information
+	bool ChangedRegion(const IsoLines&, QVector<int>&, Box2&) const;
 	int VertexSize() const;
 	double TotalLength() const;
 	QSet<double> Heights() const;
@@ -128,6 +173,13 @@ public:
 	ScalarField2 GetMask(int, int) const;
 	ScalarField2 GetMask(const Box2&, int, int) const;
 
+protected:
+	const PointIndex* CurrentPointIndex() const;
+	int ComputeParentIsoDescent(const Vector2&) const;
+	bool Insert(const IsoLinePoly&);
+	QVector<bool> PrepareAppend(const QVector<IsoLinePoly>&) const;
+
+public:
 	struct DisplayOptions
 	{
 		bool fill = false;
@@ -5,6 +5,7 @@
 #include "graph.h"
 #include "iso-line.h"
 #include "draw.h"
+#include "eden-frontier.h"
 
 
 // Version 1 vectoriel
@@ -20,7 +21,10 @@ protected:
 	int nbAssigned = 0;
 	int lastChosen = -1;
 
-	QSet<int> borders;			// Ensemble des sommets du graphe qui sont sur la bordure de la zone
+	EdenFrontier borders;		// Ensemble des sommets du graphe qui sont sur la bordure de la zone (pondrs par P)
+	// Tirages propres au gnrateur : plusieurs gnrations peuvent tourner en mme temps (thread de travail et figures)
+	Random neighbourRandom;				// Choix du voisin libre d'un noeud de bordure
+	Random nodeRandom = Random::R239;	// Choix du noeud de bordure
 
 public:
 	IsoVectoGenerationV1(const GraphPoisson&, const ScalarField2&);
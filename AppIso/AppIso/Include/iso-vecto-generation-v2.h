@@ -5,6 +5,7 @@
 #include "graph.h"
 #include "iso-line.h"
 #include "draw.h"
+#include "eden-frontier.h"
 
 
 // Version 2 vectoriel
@@ -25,7 +26,10 @@ protected:
 
 	double currentZone;
 	QSet<int> currentZoneNodes;	// Ensemble des sommets du graphe dans la zone actuelle
-	QSet<int> borders;			// Ensemble des sommets du graphe qui sont sur la bordure de la zone actuelle
+	EdenFrontier borders;		// Ensemble des sommets du graphe qui sont sur la bordure de la zone actuelle (pondrs par P)
+	// Tirages propres au gnrateur : plusieurs gnrations peuvent tourner en mme temps (thread de travail et figures)
+	Random neighbourRandom;				// Choix du voisin libre d'un noeud de bordure
+	Random nodeRandom = Random::R239;	// Choix du noeud de bordure
 
 	QSet<double> idZones;		// Les diffrentes valeurs dans Z, reprsentant les diffrentes zones
 
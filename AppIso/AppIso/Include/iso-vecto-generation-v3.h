@@ -5,6 +5,9 @@
 #include "graph.h"
 #include "iso-line.h"
 #include "draw.h"
+#include "eden-frontier.h"
+
+#include <queue>
 
 
 // Version 3 vectoriel
@@ -15,14 +18,14 @@
 class IsoVectoGenerationV3
 {
 protected:
-	GraphPoisson R;				// Les valeurs de hauteur
-	GraphPoisson Z;				// Les diffrentes zones
-	GraphPoisson P;				// Les valeurs de proba (mme graphe que Z)
+	GraphPoisson Z;				// Les diffrentes zones, c'est aussi la topologie partage par toutes les colonnes
+	GraphColumn<int> R;			// Les valeurs de hauteur (ordre d'assignation des noeuds)
+	GraphColumn<float> P;		// Les valeurs de proba
 
 	// parameters used in protected functions
-	GraphPoisson TLow;			// Valeurs temporaires pour le eden montant
-	GraphPoisson THigh;			// Valeurs temporaires pour le eden descendant
-	GraphPoisson T;				// Valeurs finales pour le choix des noeuds
+	GraphColumn<int> TLow;		// Valeurs temporaires pour le eden montant
+	GraphColumn<int> THigh;		// Valeurs temporaires pour le eden descendant
+	GraphColumn<double> T;		// Valeurs finales pour le choix des noeuds
 
 	int nbAssigned = 0;
 	int lastChosen = -1;
@@ -30,14 +33,20 @@ protected:
 	double currentZone;
 	bool withEndoreicZones;
 	QSet<int> currentZoneNodes;			// Ensemble des sommets du graphe dans la zone actuelle
-	QSet<int> internalBorders;			// Ensemble des sommets du graphe qui sont sur la bordure de la zone interne (haute)
-	QSet<int> externalBorders;			// Ensemble des sommets du graphe qui sont sur la bordure de la zone externe (basse)
-	QSet<int> accessibleElements;		// Ensemble des sommets voisins de la bordure actuel (permettant de savoir lequel est le plus petit a assigner lorsque withEndoreicZones = false)
+	EdenFrontier internalBorders;		// Ensemble des sommets du graphe qui sont sur la bordure de la zone interne (haute), pondrs par 1 - P
+	EdenFrontier externalBorders;		// Ensemble des sommets du graphe qui sont sur la bordure de la zone externe (basse), pondrs par P
+	// Tirages propres au gnrateur : plusieurs gnrations peuvent tourner en mme temps (thread de travail et figures)
+	Random neighbourRandom;				// Choix du voisin libre d'un noeud de bordure
+	Random nodeRandom = Random::R239;	// Choix du noeud de bordure
+	// Tas des sommets voisins de la bordure actuelle, tri par (T, indice) croissant (permettant de savoir lequel est le plus petit a assigner lorsque withEndoreicZones = false)
+	// Suppression paresseuse : les sommets dj assigns sont ignors lorsqu'ils arrivent en haut du tas
+	std::priority_queue<std::pair<double, int>, std::vector<std::pair<double, int>>, std::greater<std::pair<double, int>>> accessibleElements;
+	QVector<bool> accessible;			// Sommets dj ajouts aux lments accessibles (evite les doublons dans le tas)
 
 	QSet<double> idZones; // Les diffrentes valeurs dans Z, reprsentant les diffrentes zones
-	QVector<GraphPoisson> edenAsc; // To store the double eden growth if needed
-	QVector<GraphPoisson> edenDesc;
-	QVector<GraphPoisson> edenFinal;
+	QVector<GraphColumn<int>> edenAsc; // To store the double eden growth if needed (converted to GraphPoisson only when asked)
+	QVector<GraphColumn<int>> edenDesc;
+	QVector<GraphColumn<double>> edenFinal;
 
 	// debug
 	int debug = 0;
@@ -65,8 +74,9 @@ protected:
 	void FinalNodesAssignments();
 	bool FinalChooseNextNode();
 
-	int GetRandomNode(const QSet<int>&, bool);
-	double GetNextHeight();
+	int GetRandomNode(const EdenFrontier&);
+	double BorderWeight(int, bool) const;
+	int GetNextHeight();
 
 public:
 	static IsoVectoGenerationV3 TestGenerationHF(const ScalarField2&, const ScalarField2&, double, bool = false);
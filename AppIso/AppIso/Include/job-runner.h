@@ -0,0 +1,93 @@
+#pragma once
+
+#include <QtCore/QThread>
+#include <atomic>
+#include <functional>
+#include <memory>
+
+// Runs long computations (generation, terrain) on worker threads so that the interface stays responsive
+// Starting a job supersedes the previous one: it is cancelled, and its result is dropped even if it finishes afterwards
+// Results and progress are given back in the thread of the receiver (the GUI thread for a window), through its event loop
+// A job must only work on copies of its inputs, and should check IsCancelled between its steps to stop early
+class JobRunner
+{
+public:
+    // Given to a job to know if it has been superseded and to report its progress
+    class Control
+    {
+    protected:
+        std::shared_ptr<std::atomic<bool>> cancelled = std::make_shared<std::atomic<bool>>(false);
+        QObject* receiver = nullptr;
+        std::function<void(int)> progress;
+
+    public:
+        Control() {};
+        Control(QObject* receiver, std::function<void(int)> progress) : receiver(receiver), progress(progress) {};
+
+        bool IsCancelled() const;
+        void Cancel() const;
+        void SetProgress(int) const;
+    };
+
+protected:
+    QObject* receiver;          //!< results are delivered in the thread of this object
+    Control current;            //!< control of the last job started
+    QList<QThread*> threads;    //!< threads not finished yet (superseded jobs may still be running)
+
+public:
+    JobRunner(QObject*);
+    ~JobRunner();
+
+    template<typename Result>
+    void Run(std::function<Result(const Control&)>, std::function<void(const Result&)>, std::function<void(int)> = nullptr);
+    void Cancel();
+    bool IsBusy() const;
+
+protected:
+    void Start(std::function<void()>);
+};
+
+inline bool JobRunner::Control::IsCancelled() const
+{
+    return *cancelled;
+}
+
+inline void JobRunner::Control::Cancel() const
+{
+    *cancelled = true;
+}
+
+/*!
+\brief Cancel the last job started, its result will not be delivered
+*/
+inline void JobRunner::Cancel()
+{
+    current.Cancel();
+}
+
+/*!
+\brief Start a job on a new worker thread, cancelling the previous one
+\param job The computation, done on the worker thread
+\param done Called in the thread of the receiver with the result, only if no other job has been started in the meantime
+\param progress Called in the thread of the receiver each time the job reports its progress (in percent)
+*/
+template<typename Result>
+void JobRunner::Run(std::function<Result(const Control&)> job, std::function<void(const Result&)> done, std::function<void(int)> progress)
+{
+    current.Cancel();
+    Control control(receiver, progress);
+    current = control;
+
+    QObject* target = receiver;
+    Start([job, done, control, target]() {
+        Result result = job(control);
+        if (control.IsCancelled())
+            return;
+
+        QMetaObject::invokeMethod(target, [done, control, result]() {
+            // A newer job may have been started while this one was waiting in the event loop
+            if (!control.IsCancelled())
+                done(result);
+        }, Qt::QueuedConnection);
+    });
+}
@@ -5,5 +5,19 @@ class Misc
 {
 public:
 	static Mesh2 DelaunayPointsInBox(const Box2& box, double r);
+	static Mesh2 DelaunayPointsInBox(const Box2& box, double r, const ScalarField2& mask, double margin);
+	static Mesh2 SubMesh(const Mesh2& mesh, const ScalarField2& mask, QVector<int>& subToMesh, QVector<int>& meshToSub);
 	static QVector<int> IndicesBetweenMeshes(const Mesh2& m1, const Mesh2& m2, const double& mindist);
+
+protected:
+	//! Poisson tile and its triangles, the same for every call with the same parameters
+	//! Triangles are triplets of (vertex, neighbour tile) as given by DiscTileLinked::Next
+	struct PoissonTile
+	{
+		DiscTileLinked sample;
+		QVector<QPoint> triangles;
+	};
+	static const PoissonTile& CachedPoissonTile(int, double, int);
+	static Mesh2 DelaunayPointsInTiles(const Box2&, double, const ScalarField2*, double);
+	static void FillTiles(QVector<bool>&, int, int);
 };
\ No newline at end of file
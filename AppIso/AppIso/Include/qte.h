@@ -5,6 +5,7 @@
 #include "heightfield.h"
 #include "displacement-function.h"
 #include "histogramd.h"
+#include "job-runner.h"
 
 typedef TerrainRaytracingWidget::PBR_Render_Options RenderOpt;
 
@@ -220,6 +221,7 @@ class MainAmplificationWindow : public QMainWindow {
 	void GenerateV3(int = 0, const QString & = "");
 	void GenerateV3Endo(int = 0, const QString& = "");
 	void Generate(int version = 3);
+	void GenerateInBackground(int version = 3);
 
 	void RecomputeTerrainFromIsos(bool = false);
 	void SetIsos(const IsoLines&, bool = false, bool = false);
@@ -324,6 +326,49 @@ protected:
 	int m_terrain_x;
 	int m_terrain_y;
 
+	// Last terrain computed from the isos (m_hf can be modified afterwards), with the isos and terrain type it was computed from
+	// Allows to only update the part of the terrain touched by an edit
+	HeightField m_hf_computed;
+	IsoLines m_hf_isos;
+	int m_hf_terrain_type = -1;
+
+	// Everything the terrain computation needs, copied so that it can be done on the worker thread
+	struct TerrainRequest
+	{
+		IsoLines isos;
+		TerrainType type;
+		Box2 box;
+		int x, y;
+		HeightField previous;		//!< last computed terrain, see m_hf_computed
+		IsoLines previousIsos;
+		int previousType;
+	};
+	static HeightField ComputeTerrain(const TerrainRequest&);
+	void SetTerrain(const TerrainRequest&, const HeightField&, bool);
+
+	// Results of a generation, computed by RunGeneration for Generate as well as for GenerateInBackground
+	struct GenerationResult
+	{
+		GraphPoisson zones;
+		GraphPoisson result;
+		GraphPoisson proba;
+		GraphPoisson heights;
+		QVector<GraphPoisson> edenAsc;
+		QVector<GraphPoisson> edenDesc;
+		QVector<GraphPoisson> edenFinal;
+		IsoLines isos;
+		qint64 ms = 0;
+	};
+	static GenerationResult RunGenerator(const GraphPoisson&, const ScalarField2&, int, int = 0, const QString& = "");
+	static IsoLines ExtractIsos(const GraphPoisson&, const HistogramD&, GraphPoisson&);
+	static GenerationResult RunGeneration(const ScalarField2&, const ScalarField2&, const HistogramD&, double, int, const JobRunner::Control&);
+	void SetGeneratorResult(const GenerationResult&, int);
+	void SetGeneration(const GenerationResult&, int);
+
+	// Generation and terrain computations done off the GUI thread, a new job supersedes the running one
+	JobRunner m_generation_jobs{ this };
+	JobRunner m_terrain_jobs{ this };
+
 	enum EditTool { DRAWING, SMOOTHING, WARPING, SLOPING, PROTECTING };
 	EditTool m_current_tool;
 	double m_edition_radius;
@@ -0,0 +1,48 @@
+#pragma once
+
+// Bounding volume hierarchy over the edges of a closed polygon
+// Distance and inside queries only visit the nodes whose box can matter, instead of every edge of the polygon
+// Built once and only read afterwards, so it can be queried from several threads at the same time
+class SegmentBVH
+{
+protected:
+    struct Node
+    {
+        double xmin, ymin, xmax, ymax;  //!< box of all the segments below the node
+        int left = -1;                  //!< children are left and left + 1, -1 for a leaf
+        int first = 0;                  //!< segments of a leaf are [first, first + count)
+        int count = 0;
+    };
+
+    QVector<Vector2> a;     //!< first end of each segment, ordered by the build
+    QVector<Vector2> b;     //!< second end of each segment
+    QVector<Node> nodes;    //!< nodes[0] is the root
+
+public:
+    SegmentBVH() {};
+    SegmentBVH(const Polygon2&);
+
+    bool IsEmpty() const;
+    double Distance(const Vector2&, double = Math::Infinity) const;
+    bool Inside(const Vector2&) const;
+    bool Intersect(const Vector2&, const Vector2&) const;
+
+protected:
+    void Build(int, int, int, QVector<int>&);
+    double SquaredDistance(const Node&, const Vector2&) const;
+};
+
+inline bool SegmentBVH::IsEmpty() const
+{
+    return nodes.isEmpty();
+}
+
+/*!
+\brief Squared distance between a point and the box of a node (0 inside the box)
+*/
+inline double SegmentBVH::SquaredDistance(const Node& node, const Vector2& p) const
+{
+    double dx = Math::Max(0.0, Math::Max(node.xmin - p[0], p[0] - node.xmax));
+    double dy = Math::Max(0.0, Math::Max(node.ymin - p[1], p[1] - node.ymax));
+    return dx * dx + dy * dy;
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+// Dynamic weighted set over the indices [0, n) used to pick random nodes in the Eden growths
+// Stored as a sum tree: each leaf is the weight of one index and each internal node is the sum of its two children
+// Insert, Remove and Sample are all in O(log n) instead of the O(n) of a cumulative probability over a QSet
+// An index with a weight of 0 is considered outside of the set (it will never be sampled)
+class WeightedSampler
+{
+protected:
+    int n;                  //!< number of indices that can be stored
+    int leaves;             //!< first power of two >= n, leaves of the tree are in [leaves, 2 * leaves)
+    int size;               //!< number of indices with a non null weight
+    QVector<double> tree;   //!< tree[1] is the root, tree[i] = tree[2 * i] + tree[2 * i + 1]
+
+public:
+    WeightedSampler(int = 0);
+
+    void Clear();
+    void Insert(int, double);
+    void Remove(int);
+
+    bool Contains(int) const;
+    double Weight(int) const;
+    double Total() const;
+    int Size() const;
+    bool IsEmpty() const;
+
+    int Sample(double) const;
+
+protected:
+    void Update(int, double);
+};
+
+/*!
+\brief Return true if the index has a non null weight
+*/
+inline bool WeightedSampler::Contains(int i) const
+{
+    return tree[leaves + i] > 0;
+}
+
+/*!
+\brief Return the weight of index i (0 if it is not in the set)
+*/
+inline double WeightedSampler::Weight(int i) const
+{
+    return tree[leaves + i];
+}
+
+/*!
+\brief Sum of all the weights in the set
+*/
+inline double WeightedSampler::Total() const
+{
+    return tree[1];
+}
+
+/*!
+\brief Number of indices in the set
+*/
+inline int WeightedSampler::Size() const
+{
+    return size;
+}
+
+inline bool WeightedSampler::IsEmpty() const
+{
+    return size == 0;
+}
+
+/*!
+\brief Add index i to the set with weight w (or change its weight if it is already in)
+*/
+inline void WeightedSampler::Insert(int i, double w)
+{
+    Update(i, Math::Max(0.0, w));
+}
+
+/*!
+\brief Remove index i from the set
+*/
+inline void WeightedSampler::Remove(int i)
+{
+    Update(i, 0.0);
+}
@@ -2917,8 +2917,9 @@ void MainAmplificationWindow::GenerateFigure25AndTable1(const QString& prefix)
 	// This is why the runtime for one zone is twice less than with multiple zone
 	//	- when the number of zone tends to infinity -> twice longer than one zone
 	//  - in our example, the last zone often contains way less node, so even with only two zones we already atteign the maximum
-	//  - the time taken is in fact O(N*B) where B is the border size. But this size change often. We could say this is O(sqrt(N)), but it highly depends on the mask and proba field
+	//  - the time taken was in fact O(N*B) where B is the border size. But this size change often. We could say this is O(sqrt(N)), but it highly depends on the mask and proba field
 	//  - so the time taken can change according to this border
+	//  - borders are now stored in a WeightedSampler (sum tree), so picking a node is O(log N) and one eden is O(N log N)
 
 	// Time taken with one zone with different number of extracted isolines
 	auto f = [&](int nb_particles)
@@ -2956,11 +2957,12 @@ void MainAmplificationWindow::GenerateFigure25AndTable1(const QString& prefix)
 					// We do this since it is closer to the reality of time taken
 					qint64 t31 = timer.elapsed();
 
+					QVector<double> heights;
 					for (int i = 0; i < nb_isos; ++i)
 					{
-						double h = Math::Lerp(a, b, (i / (double)nb_isos));
-						Polygons2 polys = m_generation_graph_result.ContourLines(h);
+						heights.append(Math::Lerp(a, b, (i / (double)nb_isos)));
 					}
+					QVector<Polygons2> polys = m_generation_graph_result.ContourLines(heights);
 
 					qint64 t32 = timer.elapsed();
 
@@ -5308,118 +5310,255 @@ void MainAmplificationWindow::ResetGenerationZones()
 
 void MainAmplificationWindow::GenerateV1(int debug, const QString& root)
 {
-	IsoVectoGenerationV1 gen(m_generation_graph_zones, m_generation_noise);
-	gen.Generate(debug, root);
-	m_generation_graph_result = gen.Result();
-	m_generation_graph_proba = gen.Proba();
+	SetGeneratorResult(RunGenerator(m_generation_graph_zones, m_generation_noise, 1, debug, root), 1);
 }
 
 void MainAmplificationWindow::GenerateV2(int debug, const QString& root)
 {
-	IsoVectoGenerationV2 gen(m_generation_graph_zones, m_generation_noise);
-	gen.Generate(debug, root);
-	m_generation_graph_result = gen.Result();
-	m_generation_graph_proba = gen.Proba();
+	SetGeneratorResult(RunGenerator(m_generation_graph_zones, m_generation_noise, 2, debug, root), 2);
 }
 
 void MainAmplificationWindow::GenerateV3(int debug, const QString& root)
 {
-	IsoVectoGenerationV3 gen(m_generation_graph_zones, m_generation_noise);
-	gen.Generate(debug, root);
-	m_generation_graph_result = gen.Result();
-	m_generation_graph_proba = gen.Proba();
-	m_generation_graph_eden_asc = gen.EdenAsc();
-	m_generation_graph_eden_desc = gen.EdenDesc();
-	m_generation_graph_eden_final = gen.EdenFinal();
+	SetGeneratorResult(RunGenerator(m_generation_graph_zones, m_generation_noise, 3, debug, root), 3);
 }
 
 void MainAmplificationWindow::GenerateV3Endo(int debug, const QString& root)
 {
-	IsoVectoGenerationV3 gen(m_generation_graph_zones, m_generation_noise, true);
-	gen.Generate(debug, root);
-	m_generation_graph_result = gen.Result();
-	m_generation_graph_proba = gen.Proba();
+	SetGeneratorResult(RunGenerator(m_generation_graph_zones, m_generation_noise, 4, debug, root), 4);
 }
 
-// Applique la génération en fonction des paramètres donnés
-void MainAmplificationWindow::Generate(int version)
+// Assignation des hauteurs sur les zones avec la version demandée du générateur (4 = V3 avec zones endoréiques)
+// Ne touche pas à la fenêtre : utilisé par la génération directe comme par celle du thread de travail
+MainAmplificationWindow::GenerationResult MainAmplificationWindow::RunGenerator(const GraphPoisson& zones, const ScalarField2& noise, int version, int debug, const QString& root)
 {
-	// Creation of zones
-	QElapsedTimer timer;
-	timer.start();
-
-	qDebug() << "Graph creation...";
-	
-	CreateGenerationZones();
-
-	qint64 t1 = timer.elapsed();
-	qDebug() << t1 << "ms";
-
-	// Assignment of heights = Eden growth
-	qDebug() << "Heights assignments...";
+	GenerationResult r;
+	r.zones = zones;
 
 	switch (version)
 	{
 	case 1:
-		GenerateV1();
+	{
+		IsoVectoGenerationV1 gen(zones, noise);
+		gen.Generate(debug, root);
+		r.result = gen.Result();
+		r.proba = gen.Proba();
 		break;
+	}
 	case 2:
-		GenerateV2();
+	{
+		IsoVectoGenerationV2 gen(zones, noise);
+		gen.Generate(debug, root);
+		r.result = gen.Result();
+		r.proba = gen.Proba();
 		break;
+	}
 	case 3:
-		GenerateV3();
-		break;
 	case 4:
-		GenerateV3Endo();
+	{
+		IsoVectoGenerationV3 gen(zones, noise, version == 4);
+		gen.Generate(debug, root);
+		r.result = gen.Result();
+		r.proba = gen.Proba();
+		if (version == 3)
+		{
+			r.edenAsc = gen.EdenAsc();
+			r.edenDesc = gen.EdenDesc();
+			r.edenFinal = gen.EdenFinal();
+		}
 		break;
+	}
 	default:
 		qDebug() << "Iso Generation Version" << version << "does not exists.";
 		break;
 	}
+	return r;
+}
+
+// Garde le résultat du générateur (les étapes des Edens ne sont données que par la V3 sans zones endoréiques)
+void MainAmplificationWindow::SetGeneratorResult(const GenerationResult& r, int version)
+{
+	m_generation_graph_result = r.result;
+	m_generation_graph_proba = r.proba;
+	if (version == 3)
+	{
+		m_generation_graph_eden_asc = r.edenAsc;
+		m_generation_graph_eden_desc = r.edenDesc;
+		m_generation_graph_eden_final = r.edenFinal;
+	}
+}
+
+// Hauteurs données par l'histogramme au résultat du générateur, et isolignes correspondantes
+IsoLines MainAmplificationWindow::ExtractIsos(const GraphPoisson& result, const HistogramD& histogram, GraphPoisson& heights)
+{
+	heights = result;
+	heights.SetValueFromHistogram(histogram);
+	return IsoLines(heights, histogram);
+}
 
-	qint64 t2 = timer.elapsed();
-	qDebug() << t2 - t1 << "ms";
+// Toute la génération (zones, hauteurs, isolignes) à partir des paramètres, sans toucher à la fenêtre
+// control permet au thread de travail de suivre l'avancement et d'arrêter entre deux étapes
+MainAmplificationWindow::GenerationResult MainAmplificationWindow::RunGeneration(const ScalarField2& mask, const ScalarField2& noise, const HistogramD& histogram, double radius, int version, const JobRunner::Control& control)
+{
+	QElapsedTimer timer;
+	timer.start();
+
+	// Creation of zones
+	GraphPoisson zones(mask, radius);
+	zones.SetStrictValueFromScalarField(mask);
+	qDebug() << "[Zones graph] nb particles:" << zones.Size();
+	control.SetProgress(30);
+	if (control.IsCancelled())
+		return GenerationResult();
+
+	// Assignment of heights = Eden growth
+	GenerationResult r = RunGenerator(zones, noise, version);
+	control.SetProgress(70);
+	if (control.IsCancelled() || r.result.Size() == 0)
+		return r;
 
 	// Extraction of isolines
-	qDebug() << "Isolines extraction...";
+	r.isos = ExtractIsos(r.result, histogram, r.heights);
+	r.ms = timer.elapsed();
+	return r;
+}
 
-	SetIsosFromHistogram();
+// Le résultat d'une génération complète devient la génération courante
+void MainAmplificationWindow::SetGeneration(const GenerationResult& r, int version)
+{
+	m_generation_graph_zones = r.zones;
+	SetGeneratorResult(r, version);
 
-	qint64 t3 = timer.elapsed();
-	qDebug() << t3 - t2 << "ms";
+	// Pas de génération (version inconnue)
+	if (r.result.Size() != 0)
+	{
+		m_generation_graph_heights = r.heights;
+		SetIsos(r.isos, true, true);
+	}
 
 	// UI informations
-	m_test_ms_taken = t3;
+	m_test_ms_taken = r.ms;
 	m_uiw.timing_text->setText(QString::number(m_test_ms_taken) + " ms");
 	m_uiw.particles_text->setText(QString::number(m_generation_graph_result.Size()) + " particles");
 }
 
+// Applique la génération en fonction des paramètres donnés
+void MainAmplificationWindow::Generate(int version)
+{
+	// Une génération en cours sur le thread de travail ne doit pas écraser ce résultat
+	m_generation_jobs.Cancel();
+
+	QElapsedTimer timer;
+	timer.start();
+
+	GenerationResult r = RunGeneration(m_generation_mask, m_generation_noise, m_generation_histogram, m_generation_radius, version, JobRunner::Control());
+
+	// Le temps compte aussi la mise en place des isos, comme avant
+	SetGeneration(r, version);
+	m_test_ms_taken = timer.elapsed();
+	m_uiw.timing_text->setText(QString::number(m_test_ms_taken) + " ms");
+}
+
+// Même chose que Generate, mais sur le thread de travail : l'interface reste disponible et une nouvelle génération remplace celle en cours
+void MainAmplificationWindow::GenerateInBackground(int version)
+{
+	// Copies des paramètres, le calcul ne touche pas à la fenêtre
+	ScalarField2 mask = m_generation_mask;
+	ScalarField2 noise = m_generation_noise;
+	HistogramD histogram = m_generation_histogram;
+	double radius = m_generation_radius;
+
+	m_uiw.timing_text->setText("0 %");
+
+	m_generation_jobs.Run<GenerationResult>([mask, noise, histogram, radius, version](const JobRunner::Control& control) {
+		return RunGeneration(mask, noise, histogram, radius, version, control);
+	}, [this, version](const GenerationResult& r) {
+		SetGeneration(r, version);
+	}, [this](int percent) {
+		m_uiw.timing_text->setText(QString::number(percent) + " %");
+	});
+}
+
 // Change le terrain en fonction des isos
+// Le calcul est fait sur le thread de travail, une nouvelle modification des isos remplace le calcul en cours
 void MainAmplificationWindow::RecomputeTerrainFromIsos(bool resetView)
 {
 	if (!m_isos.IsEmpty())
 	{
-		IsoLineTerrain ilt(m_isos);
-		switch (m_terrain_type)
+		// Les index des isos sont construits ici : la copie partage les isos de m_isos, le thread de travail n'a plus à les écrire
+		m_isos.BuildEdgeIndices();
+
+		TerrainRequest request;
+		request.isos = m_isos;
+		request.type = m_terrain_type;
+		request.box = m_edition_box;
+		request.x = m_terrain_x;
+		request.y = m_terrain_y;
+		request.previous = m_hf_computed;
+		request.previousIsos = m_hf_isos;
+		request.previousType = m_hf_terrain_type;
+
+		// Les figures ont besoin du terrain tout de suite, le champ de chaleur utilise OpenGL et l'érosion passe par MSE : calcul direct
+		if (generate_figures || m_terrain_type == HEAT || m_terrain_type == ERODED)
 		{
-		case STAIRS:
-			m_hf = ilt.StairsField(m_edition_box, m_terrain_x, m_terrain_y);
-			break;
-		case INTERPOLATE:
-			m_hf = ilt.InterpolateField(m_edition_box, m_terrain_x, m_terrain_y);
-			break;
-		case SMOOTH_STAIRS:
-			m_hf = ilt.SmoothStairsField(m_edition_box, m_terrain_x, m_terrain_y);
-			break;
-		case ERODED:
-			m_hf = ilt.InterpolateField(m_edition_box, m_terrain_x, m_terrain_y);
-			MSE();
-			break;
-		case HEAT:
-			m_hf = ilt.HeatField(m_edition_box, m_terrain_x, m_terrain_y, true /* check with false*/);
-			break;
+			m_terrain_jobs.Cancel();
+			SetTerrain(request, ComputeTerrain(request), resetView);
+			return;
 		}
 
+		m_terrain_jobs.Run<HeightField>([request](const JobRunner::Control&) {
+			return ComputeTerrain(request);
+		}, [this, request, resetView](const HeightField& hf) {
+			SetTerrain(request, hf, resetView);
+		});
+	}
+}
+
+// Calcule le terrain demandé, ne touche pas à la fenêtre (appelé sur le thread de travail)
+HeightField MainAmplificationWindow::ComputeTerrain(const TerrainRequest& request)
+{
+	IsoLineTerrain ilt(request.isos);
+
+	// Edition locale sur le même terrain : seuls les pixels touchés sont recalculés
+	HeightField hf = request.previous;
+	Box2 hfBox = hf.GetBox();
+	bool sameTerrain = request.previousType == request.type && hf.GetSizeX() == request.x && hf.GetSizeY() == request.y
+		&& Norm(hfBox[0] - request.box[0]) == 0 && Norm(hfBox[1] - request.box[1]) == 0;
+
+	switch (request.type)
+	{
+	case STAIRS:
+		if (sameTerrain && ilt.UpdateStairsField(hf, request.previousIsos))
+			return hf;
+		return ilt.StairsField(request.box, request.x, request.y);
+	case INTERPOLATE:
+		if (sameTerrain && ilt.UpdateInterpolateField(hf, request.previousIsos))
+			return hf;
+		return ilt.InterpolateField(request.box, request.x, request.y);
+	case SMOOTH_STAIRS:
+		return ilt.SmoothStairsField(request.box, request.x, request.y);
+	case ERODED:
+		// L'érosion est faite par SetTerrain
+		return ilt.InterpolateField(request.box, request.x, request.y);
+	case HEAT:
+		// Le dernier champ de chaleur calculé sert d'estimation initiale au solveur (seules quelques isos ont changé en édition)
+		// Un terrain d'un autre type ne doit pas en servir, sinon le résultat dépendrait de l'historique
+		return ilt.HeatField(request.box, request.x, request.y, request.previousType == HEAT ? request.previous : HeightField(), true /* check with false*/);
+	}
+	return hf;
+}
+
+// Le terrain calculé pour une demande devient le terrain courant
+void MainAmplificationWindow::SetTerrain(const TerrainRequest& request, const HeightField& hf, bool resetView)
+{
+	m_hf = hf;
+	if (request.type == ERODED)
+		MSE();
+
+	m_hf_computed = m_hf;
+	m_hf_isos = request.isos;
+	m_hf_terrain_type = request.type;
+
 		//int i = 0;
 		//m_meshWidget->ClearAll();
 		//for (Mesh& m : ilt.GetMesh())
@@ -5431,12 +5570,11 @@ void MainAmplificationWindow::RecomputeTerrainFromIsos(bool resetView)
 		//}
 		//m_hf = HeightField();
 
-		if (resetView)
-		{
-			ResetCamera();
-		}
-		UpdateGeometry();
+	if (resetView)
+	{
+		ResetCamera();
 	}
+	UpdateGeometry();
 }
 
 // Change les isos
@@ -5469,9 +5607,7 @@ void MainAmplificationWindow::SetIsosFromHistogram()
 		return;
 
 	// Copie pour ne pas perdre les valeurs de progression de la génération
-	m_generation_graph_heights = m_generation_graph_result;
-	m_generation_graph_heights.SetValueFromHistogram(m_generation_histogram);
-	IsoLines isolines(m_generation_graph_heights, m_generation_histogram);
+	IsoLines isolines = ExtractIsos(m_generation_graph_result, m_generation_histogram, m_generation_graph_heights);
 	SetIsos(isolines, true, true);
 }
 
@@ -0,0 +1,83 @@
+#include "eden-frontier.h"
+
+/*!
+\brief Empty frontier on a graph of n nodes, every node is considered as already assigned
+*/
+EdenFrontier::EdenFrontier(int n) : free(n, false), freeNeighbours(n, -1), frontier(n)
+{
+}
+
+/*!
+\brief Add an already assigned node from which the growth can start
+\param g The graph on which the growth is done
+\param i The node
+\param w The weight of the node when sampling the frontier
+
+The node only enters the frontier if it has at least one free neighbour.
+*/
+void EdenFrontier::AddBorder(const GraphPoisson& g, int i, double w)
+{
+    if (free[i])
+        return;
+
+    freeNeighbours[i] = CountFreeNeighbours(g, i);
+    if (freeNeighbours[i] > 0)
+        frontier.Insert(i, w);
+}
+
+/*!
+\brief Assign a free node: it is not free anymore and becomes part of the frontier
+\param g The graph on which the growth is done
+\param i The node, which should be free
+\param w The weight of the node when sampling the frontier
+
+Only the neighbours of i are updated: each of them has one less free neighbour and leaves the frontier when it reaches 0.
+*/
+void EdenFrontier::Assign(const GraphPoisson& g, int i, double w)
+{
+    free[i] = false;
+
+    for (int n : g.Neighbours(i))
+    {
+        if (freeNeighbours[n] > 0)
+        {
+            freeNeighbours[n]--;
+            if (freeNeighbours[n] == 0)
+                frontier.Remove(n);
+        }
+    }
+
+    freeNeighbours[i] = CountFreeNeighbours(g, i);
+    if (freeNeighbours[i] > 0)
+        frontier.Insert(i, w);
+}
+
+/*!
+\brief Return the k-th free neighbour of node i, in the order given by GraphPoisson::Neighbours
+\param k should be in [0, FreeNeighbours(i))
+\return the neighbour, -1 if it does not exist
+*/
+int EdenFrontier::FreeNeighbour(const GraphPoisson& g, int i, int k) const
+{
+    for (int n : g.Neighbours(i))
+    {
+        if (free[n])
+        {
+            if (k == 0)
+                return n;
+            k--;
+        }
+    }
+    return -1;
+}
+
+int EdenFrontier::CountFreeNeighbours(const GraphPoisson& g, int i) const
+{
+    int count = 0;
+    for (int n : g.Neighbours(i))
+    {
+        if (free[n])
+            count++;
+    }
+    return count;
+}
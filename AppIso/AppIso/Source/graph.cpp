@@ -18,18 +18,53 @@ GraphPoisson::GraphPoisson(const ScalarField2& mask, double r, const double& v)
 	Vector2 border(8*r, 8*r);
 	b = Box2(b[0] - border, b[1] + border);
 
-	Mesh2 mesh = Misc::DelaunayPointsInBox(b, r);
-	Mesh2 mesh2 = mesh.SubMesh(mask); // TODO: lger bug dans cette fonction, certains points en bordure de mer n'auront pas de voisins
+	// Les tuiles loin des terres ne sont pas remplies, elles ne serviraient qu' la mer du marching triangles
+	Mesh2 mesh = Misc::DelaunayPointsInBox(b, r, mask, 8 * r);
+	// Le sous-maillage donne directement la correspondance des indices entre les deux topologies, sans recherche gomtrique
+	Mesh2 mesh2 = Misc::SubMesh(mesh, mask, topoToExt, extToTopo);
 
 	topologyExt = QSharedPointer<Tin2>::create(mesh);
 	topology = QSharedPointer<Tin2>::create(mesh2);
-
-	topoToExt = Misc::IndicesBetweenMeshes(*topology, *topologyExt, r / 2);
-	extToTopo = Misc::IndicesBetweenMeshes(*topologyExt, *topology, r / 2);
+	BuildAdjacency();
+	BuildLocator();
 
 	values.fill(v, topology->VertexSize());
 }
 
+/*
+ * Calcule une fois pour toutes les voisins de chaque sommet de `topology`, rangs  la suite dans un seul tableau (format CSR)
+ * Les copies du graphe partagent ce tableau, comme la topologie
+ * 
+ * TODO: On utilise topologyExt car elle nous permet d'viter les bugs de points seuls et ceux des points d'articulation qui ne sont pas pris en compte dans le TIN.
+ */
+void GraphPoisson::BuildAdjacency()
+{
+	adjacency = QSharedPointer<GraphAdjacency>::create();
+	int n = topology->VertexSize();
+	adjacency->offsets.reserve(n + 1);
+	adjacency->neighbours.reserve(6 * n);
+
+	adjacency->offsets.append(0);
+	for (int i = 0; i < n; ++i)
+	{
+		int start = adjacency->neighbours.size();
+		for (int ni : topologyExt->VertexNeighboursVertices(topoToExt[i]))
+		{
+			int eni = extToTopo[ni];
+			if (eni == -1)
+				continue;
+
+			// Pas de doublons (il y en a peu, la liste des voisins est courte)
+			bool found = false;
+			for (int k = start; k < adjacency->neighbours.size() && !found; ++k)
+				found = adjacency->neighbours[k] == eni;
+			if (!found)
+				adjacency->neighbours.append(eni);
+		}
+		adjacency->offsets.append(adjacency->neighbours.size());
+	}
+}
+
 /*
  * Initialise les valeurs du graphe avec le bruit donn 
  */
@@ -186,41 +221,154 @@ Box2 GraphPoisson::GetBox() const
 }
 
 /*
- * Renvoie la valeur d'un point comme une interpolation barycentrique des 3 sommets voisins
+ * Range les triangles de `topology` dans une grille de pas 2 * radius (quelques triangles par case)
+ * Comme l'adjacence, la grille ne dpend que de la topologie et est partage entre les copies du graphe
  */
-double GraphPoisson::Value(const Vector2& p) const
+void GraphPoisson::BuildLocator()
 {
-	for (int ti = 0; ti < topology->TriangleSize(); ++ti)
+	locator = QSharedPointer<TriangleGrid>::create();
+	TriangleGrid& grid = *locator;
+
+	int nt = topology->TriangleSize();
+	if (nt == 0)
+		return;
+
+	// Les valeurs ne sont pas encore alloues, on ne peut pas utiliser GetBox
+	Vector2 a = topology->Vertex(0);
+	Vector2 b = topology->Vertex(0);
+	for (int i = 1; i < topology->VertexSize(); ++i)
 	{
-		Triangle2 t = topology->GetTriangle(ti);
-		if (t.Inside(p))
-		{
-			Vector b = t.BarycentricCoordinates(p);
-			double va = At(topology->index(ti, 0));
-			double vb = At(topology->index(ti, 1));
-			double vc = At(topology->index(ti, 2));
+		Vector2 p = topology->Vertex(i);
+		a = Vector2(Math::Min(a[0], p[0]), Math::Min(a[1], p[1]));
+		b = Vector2(Math::Max(b[0], p[0]), Math::Max(b[1], p[1]));
+	}
 
-			return va * b[0] + vb * b[1] + vc * b[2];
-		}
+	grid.origin = a;
+	grid.cell = Math::Max(2 * radius, 1e-6);
+	grid.nx = int(Math::Floor((b[0] - a[0]) / grid.cell)) + 1;
+	grid.ny = int(Math::Floor((b[1] - a[1]) / grid.cell)) + 1;
+
+	// Cases touches par la bote englobante de chaque triangle
+	QVector<int> cells(4 * nt);
+	for (int ti = 0; ti < nt; ++ti)
+	{
+		Vector2 pa = topology->Vertex(topology->index(ti, 0));
+		Vector2 pb = topology->Vertex(topology->index(ti, 1));
+		Vector2 pc = topology->Vertex(topology->index(ti, 2));
+		cells[4 * ti + 0] = grid.CellX(Math::Min(pa[0], Math::Min(pb[0], pc[0])));
+		cells[4 * ti + 1] = grid.CellY(Math::Min(pa[1], Math::Min(pb[1], pc[1])));
+		cells[4 * ti + 2] = grid.CellX(Math::Max(pa[0], Math::Max(pb[0], pc[0])));
+		cells[4 * ti + 3] = grid.CellY(Math::Max(pa[1], Math::Max(pb[1], pc[1])));
+	}
+
+	// Deux passes : on compte, puis on remplit (dans l'ordre des triangles)
+	grid.offsets = QVector<int>(grid.nx * grid.ny + 1, 0);
+	for (int ti = 0; ti < nt; ++ti)
+		for (int y = cells[4 * ti + 1]; y <= cells[4 * ti + 3]; ++y)
+			for (int x = cells[4 * ti + 0]; x <= cells[4 * ti + 2]; ++x)
+				grid.offsets[y * grid.nx + x + 1]++;
+	for (int k = 0; k < grid.nx * grid.ny; ++k)
+		grid.offsets[k + 1] += grid.offsets[k];
+
+	grid.triangles = QVector<int>(grid.offsets.last());
+	QVector<int> fill = grid.offsets;
+	for (int ti = 0; ti < nt; ++ti)
+		for (int y = cells[4 * ti + 1]; y <= cells[4 * ti + 3]; ++y)
+			for (int x = cells[4 * ti + 0]; x <= cells[4 * ti + 2]; ++x)
+				grid.triangles[fill[y * grid.nx + x]++] = ti;
+}
+
+/*
+ * Renvoie le premier triangle (par indice) contenant p, -1 si p est hors du domaine
+ * Tout triangle contenant p a sa bote englobante dans la case de p, il suffit donc de tester les triangles de cette case
+ */
+int GraphPoisson::FindTriangle(const Vector2& p) const
+{
+	const TriangleGrid& grid = *locator;
+	if (grid.nx == 0)
+		return -1;
+
+	int k = grid.CellY(p[1]) * grid.nx + grid.CellX(p[0]);
+	for (int e = grid.offsets[k]; e < grid.offsets[k + 1]; ++e)
+	{
+		int ti = grid.triangles[e];
+		if (topology->GetTriangle(ti).Inside(p))
+			return ti;
 	}
+	return -1;
+}
+
+/*
+ * Interpolation barycentrique des valeurs des 3 sommets du triangle ti
+ */
+double GraphPoisson::Interpolate(int ti, const Vector2& p) const
+{
+	Vector b = topology->GetTriangle(ti).BarycentricCoordinates(p);
+	double va = At(topology->index(ti, 0));
+	double vb = At(topology->index(ti, 1));
+	double vc = At(topology->index(ti, 2));
+
+	return va * b[0] + vb * b[1] + vc * b[2];
+}
+
+/*
+ * Renvoie la valeur d'un point comme une interpolation barycentrique des 3 sommets voisins
+ */
+double GraphPoisson::Value(const Vector2& p) const
+{
+	int ti = FindTriangle(p);
 
 	// Outside the domain
-	return 0;
+	if (ti == -1)
+		return 0;
+
+	return Interpolate(ti, p);
 }
 
 /*
  * Renvoi un champs scalaire dans la range donne correspondant aux valeurs interpoles du maillage
+ * 
+ * On parcourt les triangles et on ne remplit que les pixels couverts par chacun d'eux (ligne par ligne dans sa bote englobante),
+ * au lieu de chercher un triangle pour chaque pixel. Un pixel sur une arte commune garde la valeur du premier triangle (mme rsultat que `Value`)
  */
 ScalarField2 GraphPoisson::Rasterize(const Box2& b, int w, int h) const
 {
-	ScalarField2 sf(b, w, h);
-	for (int i = 0; i < w; ++i)
+	ScalarField2 sf(b, w, h, 0);
+	QVector<bool> done(w * h, false);
+
+	// Passage des coordonnes du monde aux indices de pixels
+	double sx = (w - 1.) / (b[1][0] - b[0][0]);
+	double sy = (h - 1.) / (b[1][1] - b[0][1]);
+
+	for (int ti = 0; ti < topology->TriangleSize(); ++ti)
 	{
-		for (int j = 0; j < h; ++j)
+		Triangle2 t = topology->GetTriangle(ti);
+		Vector2 pa = topology->Vertex(topology->index(ti, 0));
+		Vector2 pb = topology->Vertex(topology->index(ti, 1));
+		Vector2 pc = topology->Vertex(topology->index(ti, 2));
+
+		// Une marge d'un pixel pour ne pas dpendre des arrondis, le test Inside dcide
+		int i0 = Math::Max(0, int(Math::Floor((Math::Min(pa[0], Math::Min(pb[0], pc[0])) - b[0][0]) * sx)) - 1);
+		int i1 = Math::Min(w - 1, int(Math::Floor((Math::Max(pa[0], Math::Max(pb[0], pc[0])) - b[0][0]) * sx)) + 1);
+		int j0 = Math::Max(0, int(Math::Floor((Math::Min(pa[1], Math::Min(pb[1], pc[1])) - b[0][1]) * sy)) - 1);
+		int j1 = Math::Min(h - 1, int(Math::Floor((Math::Max(pa[1], Math::Max(pb[1], pc[1])) - b[0][1]) * sy)) + 1);
+
+		for (int j = j0; j <= j1; ++j)
 		{
-			double x = Math::Lerp(b[0][0], b[1][0], i / (w - 1.));
 			double y = Math::Lerp(b[0][1], b[1][1], j / (h - 1.));
-			sf(i, j) = Value(Vector2(x, y));
+			for (int i = i0; i <= i1; ++i)
+			{
+				if (done[j * w + i])
+					continue;
+
+				double x = Math::Lerp(b[0][0], b[1][0], i / (w - 1.));
+				Vector2 p(x, y);
+				if (t.Inside(p))
+				{
+					sf(i, j) = Interpolate(ti, p);
+					done[j * w + i] = true;
+				}
+			}
 		}
 	}
 	return sf;
@@ -247,14 +395,11 @@ double GraphPoisson::SeaLevel() const
 	return seaValue;
 }
 
-Polygons2 GraphPoisson::ContourLines(double h) const
+/*
+ * Valeurs donnes aux sommets de topologyExt pour faire le marching triangles (voir la description de la classe)
+ */
+QVector<double> GraphPoisson::ExtendedValues(double seaValue, double exteriorValue) const
 {
-	double min, max;
-	GetRange(min, max);
-	double seaValue = SeaLevel();
-	double exteriorValue = seaValue - 100 * (max - min + 1); // valeurs trs basse
-
-	// On donne les valeurs  topologyExt, on fait le marching triangle sur ce graphe l
 	int n = topologyExt->VertexSize();
 	QVector<double> valuesExt(n, exteriorValue);
 	for (int evi = 0; evi < n; ++evi)
@@ -280,109 +425,187 @@ Polygons2 GraphPoisson::ContourLines(double h) const
 			}
 		}
 	}
+	return valuesExt;
+}
+
+Polygons2 GraphPoisson::ContourLines(double h) const
+{
+	return ContourLines(QVector<double>({ h })).first();
+}
+
+/*
+ * Contours de plusieurs hauteurs en une seule passe sur les triangles, le rsultat i correspond  heights[i]
+ * Les valeurs de topologyExt ne sont calcules qu'une fois, et chaque triangle n'est donn qu'aux hauteurs comprises entre ses valeurs min et max :
+ * extraire 30 hauteurs cote  peu prs comme en extraire une
+ */
+QVector<Polygons2> GraphPoisson::ContourLines(const QVector<double>& heights) const
+{
+	double min, max;
+	GetRange(min, max);
+	double seaValue = SeaLevel();
+	double exteriorValue = seaValue - 100 * (max - min + 1); // valeurs trs basse
+
+	// On donne les valeurs  topologyExt, on fait le marching triangle sur ce graphe l
+	QVector<double> valuesExt = ExtendedValues(seaValue, exteriorValue);
 
-	if (h <= seaValue)
+	for (double h : heights)
 	{
-		std::cerr << "[GraphPoisson] You ask to get contours of heights " << h << " while the minimum height is " << min << " and the see level is " << seaValue << " your contours will mean nothing." << std::endl;
+		if (h <= seaValue)
+		{
+			std::cerr << "[GraphPoisson] You ask to get contours of heights " << h << " while the minimum height is " << min << " and the see level is " << seaValue << " your contours will mean nothing." << std::endl;
+		}
 	}
 
-	QVector<Vector2> points;
-	QVector<int> indices;
-
-	QMap<int, int> edgeToPoint;
+	// Hauteurs tries pour retrouver par dichotomie celles qui traversent un triangle
+	int nh = heights.size();
+	QVector<int> order(nh);
+	for (int k = 0; k < nh; ++k)
+		order[k] = k;
+	std::sort(order.begin(), order.end(), [&heights](int a, int b) { return heights[a] < heights[b]; });
+	QVector<double> sorted(nh);
+	for (int k = 0; k < nh; ++k)
+		sorted[k] = heights[order[k]];
+
+	// Un contour de hauteur h traverse le triangle si un sommet est >= h et un autre < h, ie si h est dans ]min, max] du triangle
 	int m = topologyExt->TriangleSize();
-	
+	QVector<QVector<int>> crossed(nh);
 	for (int ti = 0; ti < m; ++ti)
 	{
-		int inda = topologyExt->index(ti, 0);
-		int indb = topologyExt->index(ti, 1);
-		int indc = topologyExt->index(ti, 2);
+		double va = valuesExt[topologyExt->index(ti, 0)];
+		double vb = valuesExt[topologyExt->index(ti, 1)];
+		double vc = valuesExt[topologyExt->index(ti, 2)];
+		double lo = Math::Min(va, Math::Min(vb, vc));
+		double hi = Math::Max(va, Math::Max(vb, vc));
+
+		int first = std::upper_bound(sorted.begin(), sorted.end(), lo) - sorted.begin();
+		int last = std::upper_bound(sorted.begin(), sorted.end(), hi) - sorted.begin();
+		for (int k = first; k < last; ++k)
+			crossed[k].append(ti);
+	}
 
-		double va = valuesExt[inda];
-		double vb = valuesExt[indb];
-		double vc = valuesExt[indc];
+	// Les niveaux sont indpendants, chaque thread a son propre tableau des points des artes
+	// Pas de threads pour un seul niveau (ContourLines(double)), et le tableau n'est allou que par les threads qui reoivent un niveau
+	QVector<Polygons2> contours(nh);
+	Polygons2* result = contours.data();
 
-		Vector2 pa = topologyExt->Vertex(inda);
-		Vector2 pb = topologyExt->Vertex(indb);
-		Vector2 pc = topologyExt->Vertex(indc);
+	#pragma omp parallel if (nh > 1)
+	{
+		QVector<int> edgePoint;
 
-		bool sa = va >= h;
-		bool sb = vb >= h;
-		bool sc = vc >= h;
+		#pragma omp for schedule(dynamic)
+		for (int k = 0; k < nh; ++k)
+		{
+			if (edgePoint.isEmpty())
+				edgePoint.fill(-1, 3 * m);
+			result[order[k]] = MarchingTriangles(valuesExt, sorted[k], crossed[k], edgePoint);
+		}
+	}
+	return contours;
+}
 
-		// Le contour ne passe pas par ce triangle
-		if (sa == sb && sb == sc)
-			continue;
+/*
+ * Marching triangles sur topologyExt avec les valeurs valuesExt, en temps linaire
+ * Seuls les triangles de `crossed` (traverss par le contour, par ordre croissant) sont parcourus
+ * `edgePoint` doit tre rempli de -1 (3 cases par triangle), il est remis dans cet tat  la fin pour pouvoir le rutiliser pour la hauteur suivante
+ * 
+ * Le point du contour sur une arte est rang dans les deux triangles qui la partagent (case 3 * ti + k pour l'arte oppose au sommet k),
+ * il est donc calcul une seule fois, par le premier triangle qui le rencontre
+ * Chaque segment est orient pour avoir la zone au dessus de h  sa gauche, ce qui donne directement le point suivant de chaque point :
+ * on parcourt ensuite les contours de proche en proche, sans passer par SegmentSet2::GetPolygons
+ */
+Polygons2 GraphPoisson::MarchingTriangles(const QVector<double>& valuesExt, double h, const QVector<int>& crossed, QVector<int>& edgePoint) const
+{
+	int m = topologyExt->TriangleSize();
 
-		QVector<Vector2> intersections;
-		QVector<int> facingTriangles;
+	QVector<Vector2> points;
+	QVector<int> next;			// point suivant sur le contour, -1 si le contour sort du maillage
+	QVector<bool> hasPrevious;
 
-		if (sa != sb)
+	// Point du contour sur l'arte du triangle ti oppose au sommet k
+	auto pointOnEdge = [&](int ti, int k)
+	{
+		if (edgePoint[3 * ti + k] != -1)
+			return edgePoint[3 * ti + k];
+
+		// Les extrmits dans l'ordre des sommets du triangle
+		int ia = topologyExt->index(ti, k == 0 ? 1 : 0);
+		int ib = topologyExt->index(ti, k == 2 ? 1 : 2);
+		double va = valuesExt[ia];
+		double vb = valuesExt[ib];
+		double t = (h - Math::Min(va, vb)) / Math::Abs(va - vb);
+		Vector2 p = Vector2::Lerp(topologyExt->Vertex(ia), topologyExt->Vertex(ib), va < vb ? t : 1 - t);
+
+		int id = points.size();
+		points.append(p);
+		next.append(-1);
+		hasPrevious.append(false);
+		edgePoint[3 * ti + k] = id;
+
+		// Mme point pour le triangle voisin (s'il n'est pas infini)
+		int tj = topologyExt->TriangleFacingVertex(ti, k);
+		if (tj < m)
 		{
-			double t = (h - Math::Min(va, vb)) / Math::Abs(va - vb);
-			Vector2 p = Vector2::Lerp(pa, pb, va < vb ? t : 1 - t);
-			intersections.append(p);
-			facingTriangles.append(topologyExt->TriangleFacingVertex(ti, 2));
+			for (int kj = 0; kj < 3; ++kj)
+			{
+				if (topologyExt->TriangleFacingVertex(tj, kj) == ti)
+					edgePoint[3 * tj + kj] = id;
+			}
 		}
+		return id;
+	};
 
-		if (sa != sc)
-		{
-			double t = (h - Math::Min(va, vc)) / Math::Abs(va - vc);
-			Vector2 p = Vector2::Lerp(pa, pc, va < vc ? t : 1 - t);
-			intersections.append(p);
-			facingTriangles.append(topologyExt->TriangleFacingVertex(ti, 1));
-		}
+	for (int ti : crossed)
+	{
+		bool s[3];
+		for (int k = 0; k < 3; ++k)
+			s[k] = valuesExt[topologyExt->index(ti, k)] >= h;
 
-		if (sb != sc)
-		{
-			double t = (h - Math::Min(vb, vc)) / Math::Abs(vb - vc);
-			Vector2 p = Vector2::Lerp(pb, pc, vb < vc ? t : 1 - t);
-			intersections.append(p);
-			facingTriangles.append(topologyExt->TriangleFacingVertex(ti, 0));
-		}
+		// Le contour ne passe pas par ce triangle
+		if (s[0] == s[1] && s[1] == s[2])
+			continue;
 
-		if (intersections.size() != 2)
-		{
-			qDebug() << "error: should not happend" << sa << sb << sc;
-			exit(0);
-		}
+		// Sommet seul de son ct du contour, les deux artes coupes sont celles qui le touchent
+		int l = s[0] == s[1] ? 2 : (s[0] == s[2] ? 1 : 0);
 
-		int id1 = ti + facingTriangles[0] * m;
-		int id2 = ti + facingTriangles[1] * m;
-		int inv_id1 = facingTriangles[0] + ti * m;
-		int inv_id2 = facingTriangles[1] + ti * m;
+		// Les triangles sont dans le sens trigonomtrique : on va de l'arte (l, l + 1) vers l'arte (l, l - 1) si l est au dessus
+		int p1 = pointOnEdge(ti, (l + 2) % 3);
+		int p2 = pointOnEdge(ti, (l + 1) % 3);
+		if (!s[l])
+			std::swap(p1, p2);
 
-		int index1;
-		int index2;
+		next[p1] = p2;
+		hasPrevious[p2] = true;
+	}
 
-		if (edgeToPoint.contains(inv_id1))
-		{
-			index1 = edgeToPoint[inv_id1];
-		}
-		else
+	// Les contours ouverts (coups par le bord du maillage) partent d'un point sans prcdent, les autres sont des cycles
+	QVector<Polygon2> polygons;
+	QVector<bool> visited(points.size(), false);
+	for (bool open : { true, false })
+	{
+		for (int start = 0; start < points.size(); ++start)
 		{
-			edgeToPoint[id1] = points.size();
-			index1 = points.size();
-			points.append(intersections[0]);
-		}
+			if (visited[start] || (open && hasPrevious[start]))
+				continue;
 
-		if (edgeToPoint.contains(inv_id2))
-		{
-			index2 = edgeToPoint[inv_id2];
-		}
-		else
-		{
-			edgeToPoint[id2] = points.size();
-			index2 = points.size();
-			points.append(intersections[1]);
+			QVector<Vector2> contour;
+			for (int p = start; p != -1 && !visited[p]; p = next[p])
+			{
+				visited[p] = true;
+				contour.append(points[p]);
+			}
+			polygons.append(Polygon2(contour));
 		}
+	}
 
-		indices.append(index1);
-		indices.append(index2);
+	// Un voisin qui partage une arte coupe est lui aussi travers, remettre les cases des triangles traverss suffit
+	for (int ti : crossed)
+	{
+		edgePoint[3 * ti] = -1;
+		edgePoint[3 * ti + 1] = -1;
+		edgePoint[3 * ti + 2] = -1;
 	}
 
-	SegmentSet2 ss(points, indices);
-	return ss.GetPolygons();
+	return Polygons2(polygons);
 }
 
 /*
@@ -21,6 +21,10 @@ IsoLineTerrain::IsoLineTerrain(const IsoLines& isoLines, double diffOutH, double
 		this->diffInH = diff / 2;
 	}
 	this->outH = a - this->diffOutH;
+
+	// Les requtes ponctuelles (StairsH, InterpolateH) passent par la grille tant que les isos ne changent pas
+	this->isoLines.BuildPointIndex();
+	interpolationCache = QSharedPointer<const InterpolationCache>::create(BuildInterpolationCache());
 }
 
 /*!
@@ -31,47 +35,124 @@ IsoLineTerrain::IsoLineTerrain(const IsoLines& isoLines, double diffOutH, double
 */
 double IsoLineTerrain::InterpolateH(const Vector2& p, double distToFade) const
 {
-	double epsilon = 0.0001;
-	int i1 = isoLines.ComputeParentIso(p);
+	return InterpolateH(Cache(), p, isoLines.ComputeParentIso(p), distToFade);
+}
+
+/*!
+\brief The interpolation cache of the isos, built by the constructor and then shared by every query (and by the copies of the terrain)
+*/
+const IsoLineTerrain::InterpolationCache& IsoLineTerrain::Cache() const
+{
+	return *interpolationCache;
+}
+
+/*!
+\brief Gather the isos data needed by the interpolation
+The edge index of each iso is built once (usually already by the constructor) and shared by the copies of the cache, distances cost O(log n)
+*/
+IsoLineTerrain::InterpolationCache IsoLineTerrain::BuildInterpolationCache() const
+{
+	InterpolationCache cache;
+	int n = isoLines.Size();
+
+	isoLines.BuildEdgeIndices();
+
+	cache.isos.resize(n);
+	cache.h.resize(n);
+	cache.parents.resize(n);
+	cache.children.resize(n);
+	cache.growing.resize(n);
+	cache.centers.resize(n);
+	for (int i = 0; i < n; ++i)
+	{
+		const IsoLinePoly iso = isoLines.At(i);
+		cache.isos[i] = iso;
+		cache.h[i] = iso.H();
+		cache.parents[i] = isoLines.Parent(i);
+		QSet<int> children = isoLines.Children(i);
+		cache.children[i] = QVector<int>(children.begin(), children.end());
+		cache.growing[i] = isoLines.isGrowing(i);
+		cache.centers[i] = iso.Center();
+	}
+	QSet<int> roots = isoLines.Roots();
+	cache.roots = QVector<int>(roots.begin(), roots.end());
+
+	return cache;
+}
+
+/*!
+\brief Distance between p and the iso i
+\param bound When the distance is bigger than bound, any value >= bound can be returned (allows to stop the search early)
+*/
+double IsoLineTerrain::IsoDistance(const InterpolationCache& cache, int i, const Vector2& p, double bound) const
+{
+	return cache.isos[i].DistanceIndexed(p, bound);
+}
+
+/*!
+\brief Same as IsoLines::ComputeParentIso, but starting from the parent iso of a close point
+We go up in the tree until the iso contains p, then down into the children, neighbouring pixels usually share the same parent and only one or two isos are tested.
+
+\param previous The parent iso of a close point (-1 if unknown)
+*/
+int IsoLineTerrain::ParentIso(const InterpolationCache& cache, const Vector2& p, int previous) const
+{
+	int parent = previous;
+	while (parent != -1 && !cache.isos[parent].InsideIndexed(p))
+		parent = cache.parents[parent];
+
+	const QVector<int>* toCheck = parent == -1 ? &cache.roots : &cache.children[parent];
+	bool found = true;
+	while (found)
+	{
+		found = false;
+		for (int c : *toCheck)
+		{
+			if (cache.isos[c].InsideIndexed(p))
+			{
+				parent = c;
+				toCheck = &cache.children[c];
+				found = true;
+				break;
+			}
+		}
+	}
+
+	return parent;
+}
 
+/*!
+\brief Interpolation of the height of p, knowing its parent iso i1 (see InterpolateH above)
+*/
+double IsoLineTerrain::InterpolateH(const InterpolationCache& cache, const Vector2& p, int i1, double distToFade) const
+{
 	// Cas o on est  l'extrieur des isos
 	if (i1 == -1)
 	{
 		double dist = Math::Infinity;
-		double h1 = isoLines[*isoLines.Roots().begin()].H();
-		for (int c : isoLines.Roots())
+		for (int c : cache.roots)
 		{
-			dist = Math::Min(dist, fabs(isoLines[c].Signed(p)));
+			dist = Math::Min(dist, IsoDistance(cache, c, p, dist));
 		}
 
-		double h2 = h1 - diffOutH;
-
-		if (dist > distToFade)
-			return h2;
-
-		// Pour viter les imprcisions numriques
-		if (dist < epsilon)
-			return h1;
-
-		// Interpolation linaire entre h1 et h2
-		return (h2 * dist + h1 * (distToFade - dist)) / distToFade;
+		return OutsideH(cache, dist, distToFade);
 	}
 
 	// Cas  l'intrieur d'une iso
-	double h1 = isoLines[i1].H();
+	double h1 = cache.h[i1];
 
 	// Distance par rapport  l'iso extrieure
-	double d1 = fabs(isoLines[i1].Signed(p));
+	double d1 = IsoDistance(cache, i1, p, Math::Infinity);
 
 	// Plus petite distance par rapport  toutes les isos enfants
 	double d2 = Math::Infinity;
 	int i2 = 0;
-	for (int c : isoLines.Children(i1))
+	for (int c : cache.children[i1])
 	{
-		double d = fabs(isoLines[c].Signed(p));
 		// [ENDOREIC] Small correction for endoreic areas, permettant de rcuprer la vraie zone la plus proche
-		if (isoLines[c].H() == h1)
+		if (cache.h[c] == h1)
 		{
+			double d = IsoDistance(cache, c, p, d1);
 			if (d1 > d)
 			{
 				d1 = d;
@@ -80,6 +161,7 @@ double IsoLineTerrain::InterpolateH(const Vector2& p, double distToFade) const
 		}
 		else
 		{
+			double d = IsoDistance(cache, c, p, d2);
 			if (d2 > d)
 			{
 				d2 = d;
@@ -88,18 +170,51 @@ double IsoLineTerrain::InterpolateH(const Vector2& p, double distToFade) const
 		}
 	}
 
+	return BlendH(cache, p, i1, d1, i2, d2);
+}
+
+/*!
+\brief Height outside all the isos, at distance dist of the closest root iso (see InterpolateH)
+*/
+double IsoLineTerrain::OutsideH(const InterpolationCache& cache, double dist, double distToFade) const
+{
+	double epsilon = 0.0001;
+	double h1 = cache.h[cache.roots.first()];
+	double h2 = h1 - diffOutH;
+
+	if (dist > distToFade)
+		return h2;
+
+	// Pour viter les imprcisions numriques
+	if (dist < epsilon)
+		return h1;
+
+	// Interpolation linaire entre h1 et h2
+	return (h2 * dist + h1 * (distToFade - dist)) / distToFade;
+}
+
+/*!
+\brief Height inside the iso i1 (see InterpolateH)
+\param d1 Distance to i1 (or to its children at the same height)
+\param i2 A child of i1 at a different height
+\param d2 Distance to the closest child at a different height, infinity if there is none
+*/
+double IsoLineTerrain::BlendH(const InterpolationCache& cache, const Vector2& p, int i1, double d1, int i2, double d2) const
+{
+	double epsilon = 0.0001;
+	double h1 = cache.h[i1];
+
 	// Si d2 vaut l'infini c'est qu'on a deux possibilit
 	// 1. On a pas d'enfant (on est un pic - ou un creux si endoreic)
 	// 2. [ENDOREIC] On a des enfants mais ils sont tous  la meme hauteur -> on est aussi un bassin ou un pic (juste il y a des zones endoreics)
 	// On utilise la distance au centre de l'iso comme point le plus haut et on interpole
 	if (d2 == Math::Infinity)
 	{
-		Vector2 center = isoLines[i1].Center();
-		d2 = Norm(center - p);
+		d2 = Norm(cache.centers[i1] - p);
 
 		double h2 = h1 + diffInH;
 		// Small correction for endoreic areas
-		if (!isoLines.isGrowing(i1))
+		if (!cache.growing[i1])
 			h2 = Math::Max(outH, h1 - diffInH);
 
 		// Pour viter les imprcisions numriques
@@ -111,7 +226,7 @@ double IsoLineTerrain::InterpolateH(const Vector2& p, double distToFade) const
 	}
 
 	// Hauteur intrieur
-	double h2 = isoLines[i2].H();
+	double h2 = cache.h[i2];
 
 	// Pour viter les imprcisions numriques
 	if (d2 < epsilon)
@@ -134,13 +249,38 @@ double IsoLineTerrain::InterpolateH(const Vector2& p, double distToFade) const
 HeightField IsoLineTerrain::InterpolateField(const Box2& b, int x, int y, double distToFade) const
 {
 	HeightField sf(b, x, y);
+	if (isoLines.IsEmpty())
+		return sf;
 
-	//#pragma omp parallel for
-	for (int i = 0; i < x; ++i)
+	const InterpolationCache& cache = Cache();
+
+	// Le champ est dcoup en tuiles traites en parallle
+	// Dans une tuile, on parcourt les lignes et l'iso parente d'un pixel est cherche  partir de celle du pixel prcdent
+	const int tile = 32;
+	int tx = (x + tile - 1) / tile;
+	int ty = (y + tile - 1) / tile;
+
+	#pragma omp parallel for schedule(dynamic)
+	for (int t = 0; t < tx * ty; ++t)
 	{
-		for (int j = 0; j < y; ++j)
+		int i0 = (t % tx) * tile;
+		int j0 = (t / tx) * tile;
+		int i1 = Math::Min(i0 + tile, x);
+		int j1 = Math::Min(j0 + tile, y);
+
+		int rowParent = -1;
+		for (int j = j0; j < j1; ++j)
 		{
-			sf(i, j) = InterpolateH(sf.Vertex(i, j), distToFade);
+			int parent = rowParent;
+			for (int i = i0; i < i1; ++i)
+			{
+				Vector2 p = sf.Vertex(i, j);
+				parent = ParentIso(cache, p, parent);
+				if (i == i0)
+					rowParent = parent;
+
+				sf(i, j) = InterpolateH(cache, p, parent, distToFade);
+			}
 		}
 	}
 
@@ -159,6 +299,406 @@ HeightField IsoLineTerrain::InterpolateField(int x, int y, double distToFade) co
 	return InterpolateField(isoLines.GetBox(), x, y, distToFade);
 }
 
+/*!
+\brief Update a field computed by InterpolateField with the previous version of the isos, after a local modification (brush, warp...)
+
+Only the pixels whose height can change are computed again:
+the pixels in the box of the moved edges (their parent iso may have changed), the pixels whose parent is a modified iso or the parent of a modified iso
+(their distances or the center of their iso may have changed), and if a root moved, the pixels outside the isos close enough to fade.
+The result is the same as calling InterpolateField again.
+
+\param hf The field to update, computed from previous with the same parameters
+\param previous The isos hf was computed from
+\return false if the modification is not local (see IsoLines::ChangedRegion) and nothing has been done, the whole field has to be computed again
+*/
+bool IsoLineTerrain::UpdateInterpolateField(HeightField& hf, const IsoLines& previous, double distToFade) const
+{
+	QVector<int> changed;
+	Box2 region;
+	if (!isoLines.ChangedRegion(previous, changed, region))
+		return false;
+	if (changed.isEmpty())
+		return true;
+
+	// Isos dont l'intrieur dpend des isos modifies
+	QSet<int> affected;
+	bool rootChanged = false;
+	Box2 box = region;
+	for (int i : changed)
+	{
+		affected.insert(i);
+		int parent = isoLines.Parent(i);
+		if (parent == -1)
+			rootChanged = true;
+		else
+			affected.insert(parent);
+	}
+	for (int i : affected)
+		box = Box2(box, isoLines.At(i).GetBox());
+
+	Vector2 fade(distToFade, distToFade);
+	Box2 fadeRegion(region[0] - fade, region[1] + fade);
+	if (rootChanged)
+		box = Box2(box, fadeRegion);
+
+	int i0, j0, i1, j1;
+	if (!PixelRange(hf, box, i0, j0, i1, j1))
+		return true;
+
+	int w = i1 - i0 + 1;
+	int h = j1 - j0 + 1;
+	QVector<double> xs(w), ys(h);
+	for (int i = 0; i < w; ++i)
+		xs[i] = hf.Vertex(i0 + i, 0)[0];
+	for (int j = 0; j < h; ++j)
+		ys[j] = hf.Vertex(0, j0 + j)[1];
+	QVector<int> parents = isoLines.ComputeParentIsos(xs, ys);
+
+	const InterpolationCache& cache = Cache();
+
+	#pragma omp parallel for schedule(dynamic)
+	for (int j = 0; j < h; ++j)
+	{
+		for (int i = 0; i < w; ++i)
+		{
+			Vector2 p(xs[i], ys[j]);
+			int parent = parents[i + w * j];
+			bool update = region.Inside(p) || affected.contains(parent) || (rootChanged && parent == -1 && fadeRegion.Inside(p));
+			if (update)
+				hf(i0 + i, j0 + j) = InterpolateH(cache, p, parent, distToFade);
+		}
+	}
+
+	return true;
+}
+
+/*!
+\brief Pixels of a field inside a box
+\return false if the box does not cover any pixel
+*/
+bool IsoLineTerrain::PixelRange(const HeightField& hf, const Box2& box, int& i0, int& j0, int& i1, int& j1)
+{
+	int x = hf.GetSizeX();
+	int y = hf.GetSizeY();
+	Vector2 origin = hf.Vertex(0, 0);
+	double dx = x > 1 ? hf.Vertex(1, 0)[0] - origin[0] : 1.0;
+	double dy = y > 1 ? hf.Vertex(0, 1)[1] - origin[1] : 1.0;
+
+	i0 = Math::Max(0, int(floor((box[0][0] - origin[0]) / dx)));
+	j0 = Math::Max(0, int(floor((box[0][1] - origin[1]) / dy)));
+	i1 = Math::Min(x - 1, int(ceil((box[1][0] - origin[0]) / dx)));
+	j1 = Math::Min(y - 1, int(ceil((box[1][1] - origin[1]) / dy)));
+	return i0 <= i1 && j0 <= j1;
+}
+
+/*!
+\brief Same as InterpolateField, but the closest isos are found with distance transforms of their rasterized boundaries instead of per pixel searches
+
+For each iso, two exact euclidean distance transforms (Felzenszwalb and Huttenlocher, linear time) with their feature transform are computed on the pixels of its box:
+one to the iso itself and its children at the same height, one to its other children. Only the pixels whose parent is the iso keep the result, which is the iso holding their nearest boundary pixel.
+The distances are then the exact distances to these isos, so the field is the one of InterpolateField up to pixels almost equidistant to two isos.
+The transforms are linear in the number of pixels of the boxes (the pixels times the depth of the isos), then each pixel makes two distance queries instead of one per child.
+
+\param b The box.
+\param x Precision in x.
+\param y Precision in y.
+\param distToFade Distance to pass from first iso height to outH height (to avoid instant cliff)
+*/
+HeightField IsoLineTerrain::InterpolateFieldDT(const Box2& b, int x, int y, double distToFade) const
+{
+	HeightField sf(b, x, y);
+	if (isoLines.IsEmpty())
+		return sf;
+
+	const InterpolationCache& cache = Cache();
+	int n = isoLines.Size();
+
+	QVector<double> xs(x), ys(y);
+	for (int i = 0; i < x; ++i)
+		xs[i] = sf.Vertex(i, 0)[0];
+	for (int j = 0; j < y; ++j)
+		ys[j] = sf.Vertex(0, j)[1];
+	QVector<int> parents = isoLines.ComputeParentIsos(xs, ys);
+
+	Vector2 origin(xs[0], ys[0]);
+	double dx = x > 1 ? xs[1] - xs[0] : 1.0;
+	double dy = y > 1 ? ys[1] - ys[0] : 1.0;
+
+	// Les isos sans pixel n'ont pas besoin de transforme
+	QVector<int> count(n, 0);
+	for (int k = 0; k < x * y; ++k)
+	{
+		if (parents[k] != -1)
+			count[parents[k]]++;
+	}
+
+	// Iso la plus proche de chaque pixel : bordure extrieure de sa rgion, puis enfants  une autre hauteur
+	QVector<int> l1(x * y, -1);
+	QVector<int> l2(x * y, -1);
+	int* pl1 = l1.data();
+	int* pl2 = l2.data();
+
+	// Extrieur : isos racines sur tout le champ
+	{
+		QVector<double> f(x * y, Math::Infinity);
+		QVector<int> label(x * y, -1);
+		for (int c : cache.roots)
+			RasterizeBoundary(cache, c, f, label, 0, 0, x, y, origin, dx, dy);
+		DistanceTransform(f, label, x, y, dx, dy);
+
+		for (int k = 0; k < x * y; ++k)
+		{
+			if (parents[k] == -1)
+				l1[k] = label[k];
+		}
+	}
+
+	// Intrieur de chaque iso, sur les pixels de sa bote (les pixels dont elle est parente y sont tous)
+	#pragma omp parallel for schedule(dynamic)
+	for (int i = 0; i < n; ++i)
+	{
+		if (count[i] == 0)
+			continue;
+
+		Box2 ib = cache.isos[i].GetBox();
+		int i0 = Math::Max(0, int(floor((ib[0][0] - origin[0]) / dx)) - 1);
+		int j0 = Math::Max(0, int(floor((ib[0][1] - origin[1]) / dy)) - 1);
+		int i1 = Math::Min(x - 1, int(ceil((ib[1][0] - origin[0]) / dx)) + 1);
+		int j1 = Math::Min(y - 1, int(ceil((ib[1][1] - origin[1]) / dy)) + 1);
+		if (i0 > i1 || j0 > j1)
+			continue;
+
+		int w = i1 - i0 + 1;
+		int h = j1 - j0 + 1;
+		QVector<double> f(w * h);
+		QVector<int> label(w * h);
+
+		// [ENDOREIC] Les enfants  la mme hauteur comptent comme l'iso elle-mme, comme dans InterpolateH
+		for (int side = 0; side < 2; ++side)
+		{
+			int* pl = side == 0 ? pl1 : pl2;
+			f.fill(Math::Infinity);
+			label.fill(-1);
+
+			bool any = false;
+			if (side == 0)
+			{
+				RasterizeBoundary(cache, i, f, label, i0, j0, w, h, origin, dx, dy);
+				any = true;
+			}
+			for (int c : cache.children[i])
+			{
+				if ((cache.h[c] == cache.h[i]) == (side == 0))
+				{
+					RasterizeBoundary(cache, c, f, label, i0, j0, w, h, origin, dx, dy);
+					any = true;
+				}
+			}
+			if (!any)
+				continue;
+
+			DistanceTransform(f, label, w, h, dx, dy);
+
+			for (int j = j0; j <= j1; ++j)
+			{
+				for (int k = i0; k <= i1; ++k)
+				{
+					int pixel = k + x * j;
+					if (parents[pixel] == i)
+						pl[pixel] = label[(k - i0) + w * (j - j0)];
+				}
+			}
+		}
+	}
+
+	#pragma omp parallel for
+	for (int j = 0; j < y; ++j)
+	{
+		for (int i = 0; i < x; ++i)
+		{
+			int k = i + x * j;
+			int parent = parents[k];
+			Vector2 p(xs[i], ys[j]);
+			if (parent == -1)
+			{
+				double d1 = l1[k] == -1 ? Math::Infinity : IsoDistance(cache, l1[k], p, Math::Infinity);
+				sf(i, j) = OutsideH(cache, d1, distToFade);
+			}
+			else
+			{
+				// Comme dans InterpolateH, i1 devient l'enfant  la mme hauteur s'il est le plus proche
+				int i1 = l1[k] == -1 ? parent : l1[k];
+				int i2 = l2[k];
+				double d1 = IsoDistance(cache, i1, p, Math::Infinity);
+				double d2 = i2 == -1 ? Math::Infinity : IsoDistance(cache, i2, p, Math::Infinity);
+				sf(i, j) = BlendH(cache, p, i1, d1, i2, d2);
+			}
+		}
+	}
+
+	return sf;
+}
+
+/*!
+\brief Same as InterpolateField(int, int, double) with distance transforms, see InterpolateFieldDT above
+*/
+HeightField IsoLineTerrain::InterpolateFieldDT(int x, int y, double distToFade) const
+{
+	return InterpolateFieldDT(isoLines.GetBox(), x, y, distToFade);
+}
+
+/*!
+\brief Set the pixels close to the boundary of the iso e to their exact squared distance to it, and label them with e (keeps the closest iso when several are rasterized)
+
+The edges are walked with a step of half a pixel, the 3x3 pixels around each step are updated.
+
+\param f, label Values of the window [i0, i0 + w) x [j0, j0 + h) of the grid
+\param origin Position of the pixel (0, 0) of the grid
+\param dx, dy Size of a pixel
+*/
+void IsoLineTerrain::RasterizeBoundary(const InterpolationCache& cache, int e, QVector<double>& f, QVector<int>& label, int i0, int j0, int w, int h, const Vector2& origin, double dx, double dy)
+{
+	const IsoLinePoly& iso = cache.isos[e];
+	int m = iso.Size();
+	double step = 0.5 * Math::Min(dx, dy);
+	for (int s = 0; s < m; ++s)
+	{
+		Vector2 a = iso.Vertex(s);
+		Vector2 b = iso.Vertex((s + 1) % m);
+		double ux = b[0] - a[0];
+		double uy = b[1] - a[1];
+		double l = ux * ux + uy * uy;
+		int samples = int(ceil(sqrt(l) / step));
+
+		for (int t = 0; t <= samples; ++t)
+		{
+			double u = samples == 0 ? 0.0 : t / double(samples);
+			int ci = int(floor((a[0] + u * ux - origin[0]) / dx + 0.5));
+			int cj = int(floor((a[1] + u * uy - origin[1]) / dy + 0.5));
+
+			for (int j = Math::Max(j0, cj - 1); j <= Math::Min(j0 + h - 1, cj + 1); ++j)
+			{
+				for (int i = Math::Max(i0, ci - 1); i <= Math::Min(i0 + w - 1, ci + 1); ++i)
+				{
+					// Distance exacte du centre du pixel au segment [a, b]
+					double vx = origin[0] + i * dx - a[0];
+					double vy = origin[1] + j * dy - a[1];
+					double tp = l > 0 ? Math::Min(1.0, Math::Max(0.0, (ux * vx + uy * vy) / l)) : 0.0;
+					double rx = vx - tp * ux;
+					double ry = vy - tp * uy;
+					double d = rx * rx + ry * ry;
+					int k = (i - i0) + w * (j - j0);
+					if (d < f[k])
+					{
+						f[k] = d;
+						label[k] = e;
+					}
+				}
+			}
+		}
+	}
+}
+
+/*!
+\brief Squared euclidean distance transform of a sampled function and its feature transform, in place
+f becomes min over q of |p - q|^2 + f(q), computed with the lower envelope of parabolas (Felzenszwalb and Huttenlocher), on the rows then on the columns, and label the label of the minimizing q
+
+\param f Values of a w x h grid, 0 (or a squared distance) on the seeds and infinity elsewhere
+\param label Labels of the seeds, -1 elsewhere
+\param dx, dy Size of a pixel
+*/
+void IsoLineTerrain::DistanceTransform(QVector<double>& f, QVector<int>& label, int w, int h, double dx, double dy)
+{
+	int n = Math::Max(w, h);
+	QVector<double> g(n), d(n), z(n + 1);
+	QVector<int> gl(n), dl(n), v(n);
+
+	for (int j = 0; j < h; ++j)
+	{
+		for (int i = 0; i < w; ++i)
+		{
+			g[i] = f[i + w * j];
+			gl[i] = label[i + w * j];
+		}
+		DistanceTransform(g.constData(), gl.constData(), d.data(), dl.data(), w, dx, v.data(), z.data());
+		for (int i = 0; i < w; ++i)
+		{
+			f[i + w * j] = d[i];
+			label[i + w * j] = dl[i];
+		}
+	}
+
+	for (int i = 0; i < w; ++i)
+	{
+		for (int j = 0; j < h; ++j)
+		{
+			g[j] = f[i + w * j];
+			gl[j] = label[i + w * j];
+		}
+		DistanceTransform(g.constData(), gl.constData(), d.data(), dl.data(), h, dy, v.data(), z.data());
+		for (int j = 0; j < h; ++j)
+		{
+			f[i + w * j] = d[j];
+			label[i + w * j] = dl[j];
+		}
+	}
+}
+
+/*!
+\brief One dimensional version of the distance transform: d[q] = min over p of (s (q - p))^2 + f[p], and dl[q] = fl[p] for the minimizing p
+\param v, z Work arrays of size n and n + 1 (parabolas of the envelope and their boundaries)
+*/
+void IsoLineTerrain::DistanceTransform(const double* f, const int* fl, double* d, int* dl, int n, double s, int* v, double* z)
+{
+	double s2 = s * s;
+
+	// Premier chantillon fini
+	int first = 0;
+	while (first < n && f[first] == Math::Infinity)
+		first++;
+	if (first == n)
+	{
+		for (int q = 0; q < n; ++q)
+		{
+			d[q] = Math::Infinity;
+			dl[q] = -1;
+		}
+		return;
+	}
+
+	int k = 0;
+	v[0] = first;
+	z[0] = -Math::Infinity;
+	z[1] = Math::Infinity;
+	for (int q = first + 1; q < n; ++q)
+	{
+		if (f[q] == Math::Infinity)
+			continue;
+
+		// Intersection de la parabole de q avec la dernire de l'enveloppe
+		double x = ((f[q] + s2 * q * q) - (f[v[k]] + s2 * v[k] * v[k])) / (2 * s2 * (q - v[k]));
+		while (x <= z[k])
+		{
+			k--;
+			x = ((f[q] + s2 * q * q) - (f[v[k]] + s2 * v[k] * v[k])) / (2 * s2 * (q - v[k]));
+		}
+		k++;
+		v[k] = q;
+		z[k] = x;
+		z[k + 1] = Math::Infinity;
+	}
+
+	k = 0;
+	for (int q = 0; q < n; ++q)
+	{
+		while (z[k + 1] < q)
+			k++;
+		double e = s * (q - v[k]);
+		d[q] = e * e + f[v[k]];
+		dl[q] = fl[v[k]];
+	}
+}
+
 /*!
 \brief Heights as directly given by the set of isos
 */
@@ -181,12 +721,25 @@ HeightField IsoLineTerrain::StairsField(const Box2& b, int x, int y) const
 {
 	HeightField sf(b, x, y);
 
+	// Iso parente de tous les pixels d'un coup (remplissage par lignes de balayage), puis hauteur de chaque iso calcule une seule fois
+	QVector<double> xs(x), ys(y);
+	for (int i = 0; i < x; ++i)
+		xs[i] = sf.Vertex(i, 0)[0];
+	for (int j = 0; j < y; ++j)
+		ys[j] = sf.Vertex(0, j)[1];
+	QVector<int> parents = isoLines.ComputeParentIsos(xs, ys);
+
+	QVector<double> heights(isoLines.Size());
+	for (int k = 0; k < isoLines.Size(); ++k)
+		heights[k] = isoLines.HeightInside(k);
+
 	#pragma omp parallel for
 	for (int i = 0; i < x; ++i)
 	{
 		for (int j = 0; j < y; ++j)
 		{
-			sf(i, j) = StairsH(sf.Vertex(i, j));
+			int parent = parents[i + x * j];
+			sf(i, j) = parent == -1 ? outH : heights[parent];
 		}
 	}
 
@@ -204,6 +757,50 @@ HeightField IsoLineTerrain::StairsField(int x, int y) const
 	return StairsField(isoLines.GetBox(), x, y);
 }
 
+/*!
+\brief Update a field computed by StairsField with the previous version of the isos, after a local modification
+Only the pixels in the box of the moved edges can change of parent iso, the others are kept.
+
+\param hf The field to update, computed from previous
+\param previous The isos hf was computed from
+\return false if the modification is not local (see IsoLines::ChangedRegion) and nothing has been done
+*/
+bool IsoLineTerrain::UpdateStairsField(HeightField& hf, const IsoLines& previous) const
+{
+	QVector<int> changed;
+	Box2 region;
+	if (!isoLines.ChangedRegion(previous, changed, region))
+		return false;
+
+	int i0, j0, i1, j1;
+	if (changed.isEmpty() || !PixelRange(hf, region, i0, j0, i1, j1))
+		return true;
+
+	int w = i1 - i0 + 1;
+	int h = j1 - j0 + 1;
+	QVector<double> xs(w), ys(h);
+	for (int i = 0; i < w; ++i)
+		xs[i] = hf.Vertex(i0 + i, 0)[0];
+	for (int j = 0; j < h; ++j)
+		ys[j] = hf.Vertex(0, j0 + j)[1];
+	QVector<int> parents = isoLines.ComputeParentIsos(xs, ys);
+
+	QVector<double> heights(isoLines.Size());
+	for (int k = 0; k < isoLines.Size(); ++k)
+		heights[k] = isoLines.HeightInside(k);
+
+	for (int j = 0; j < h; ++j)
+	{
+		for (int i = 0; i < w; ++i)
+		{
+			int parent = parents[i + w * j];
+			hf(i0 + i, j0 + j) = parent == -1 ? outH : heights[parent];
+		}
+	}
+
+	return true;
+}
+
 /*!
 \brief Returns the height field of this terrain given a certain box and precision - with stairs style, but smoothed to allow a better rendering
 
@@ -245,42 +842,110 @@ HeightField IsoLineTerrain::SmoothStairsField(int x, int y, int nsmooth) const
 #include "diffusion.h"
 HeightField IsoLineTerrain::HeatField(const Box2& b, int x, int y, bool baseInter) const
 {
-	HeightField stairs = StairsField(b, x, y);
-	HeightField base = baseInter ? InterpolateField(b, x, y) : stairs;
+	return HeatField(b, x, y, HeightField(), baseInter);
+}
+
+/*!
+\brief Same as above, but the solver starts from a previous result (for example the field before some isos were edited)
+
+The constrained pixels (just above an iso boundary, and the border of the field inside the isos) are found from the parent iso of each pixel.
+Without a usable previous result, the solver starts from the whole interpolation (or the stairs) as HeatField always did, so the result does not depend on the edition history.
+With it, there is no dense pre-pass: only the constrained pixels get their exact value (height of the interpolation, or of the stairs), the other ones keep the previous result.
+
+\param previous Initial guess, ignored if its box or size is not the one asked
+*/
+HeightField IsoLineTerrain::HeatField(const Box2& b, int x, int y, const HeightField& previous, bool baseInter) const
+{
+	HeightField base(b, x, y, 0);
 	HeightField mask(b, x, y, 0);
+	if (isoLines.IsEmpty())
+		return base;
+
+	// Iso parente de chaque pixel (lignes de balayage) et hauteurs en escalier
+	QVector<double> xs(x), ys(y);
 	for (int i = 0; i < x; ++i)
+		xs[i] = base.Vertex(i, 0)[0];
+	for (int j = 0; j < y; ++j)
+		ys[j] = base.Vertex(0, j)[1];
+	QVector<int> parents = isoLines.ComputeParentIsos(xs, ys);
+
+	QVector<double> heights(isoLines.Size());
+	for (int k = 0; k < isoLines.Size(); ++k)
+		heights[k] = isoLines.HeightInside(k);
+
+	QVector<double> stairs(x * y);
+	for (int k = 0; k < x * y; ++k)
+		stairs[k] = parents[k] == -1 ? outH : heights[parents[k]];
+
+	// Contraintes : mmes rgles que sur le champ en escalier
+	QVector<int> constrained;
+	for (int j = 0; j < y; ++j)
 	{
-		for (int j = 0; j < y; ++j)
+		for (int i = 0; i < x; ++i)
 		{
+			double v = stairs[i + x * j];
+			bool c = false;
 			if (i == 0 || j == 0 || i == x - 1 || j == y - 1)
 			{
-				if (stairs(i, j) != diffOutH)
-				{
-					mask(i, j) = 1;
-				}
+				c = v != diffOutH;
 			}
 			else
 			{
-				double v = stairs(i, j);
-				//if (stairs(i + 1, j) < v)
-				//	mask(i, j) = 1;
-				//if (stairs(i - 1, j) < v)
-				//	mask(i, j) = 1;
-				//if (stairs(i, j + 1) < v)
-				//	mask(i, j) = 1;
-				//if (stairs(i, j - 1) < v)
-				//	mask(i, j) = 1;
-				for (int ii = i - 1; ii <= i + 1; ++ii)
+				for (int jj = j - 1; jj <= j + 1 && !c; ++jj)
 				{
-					for (int jj = j - 1; jj <= j + 1; ++jj)
+					for (int ii = i - 1; ii <= i + 1 && !c; ++ii)
 					{
-						if (stairs(ii, jj) < v)
-						{
-							mask(i, j) = 1;
-						}
+						if (stairs[ii + x * jj] < v)
+							c = true;
 					}
 				}
 			}
+
+			if (c)
+			{
+				mask(i, j) = 1;
+				constrained.append(i + x * j);
+			}
+		}
+	}
+
+	// Estimation initiale : le rsultat prcdent s'il a la mme grille, sinon celle de toujours
+	Box2 pb = previous.GetBox();
+	bool warm = previous.GetSizeX() == x && previous.GetSizeY() == y && Norm(pb[0] - b[0]) + Norm(pb[1] - b[1]) < 1e-9 * Norm(b.Diagonal());
+	if (!warm)
+	{
+		if (baseInter)
+		{
+			base = InterpolateField(b, x, y);
+		}
+		else
+		{
+			for (int j = 0; j < y; ++j)
+				for (int i = 0; i < x; ++i)
+					base(i, j) = stairs[i + x * j];
+		}
+	}
+	else
+	{
+		base = previous;
+
+		// Valeurs exactes sur les pixels contraints uniquement
+		if (baseInter)
+		{
+			const InterpolationCache& cache = Cache();
+			int nc = constrained.size();
+
+			#pragma omp parallel for schedule(dynamic)
+			for (int c = 0; c < nc; ++c)
+			{
+				int k = constrained[c];
+				base(k % x, k / x) = InterpolateH(cache, Vector2(xs[k % x], ys[k / x]), parents[k], 0.0);
+			}
+		}
+		else
+		{
+			for (int k : constrained)
+				base(k % x, k / x) = stairs[k];
 		}
 	}
 
@@ -3,6 +3,8 @@
 #include "curvepoint.h"
 #include "displacement-function.h"
 
+#include <set>
+
 using namespace std;
 
 /*!
@@ -28,6 +30,24 @@ IsoLinePoly::IsoLinePoly(const Polygon2& poly, double h) : Polygon2(poly), h(h)
 	//ChangeOrder(true);
 }
 
+/*!
+\brief Copy constructor, the copy shares the edge index of p
+*/
+IsoLinePoly::IsoLinePoly(const IsoLinePoly& p) : Polygon2(p), h(p.h), edgeIndex(p.edgeIndex.load())
+{
+}
+
+/*!
+\brief Assignment, this polygon shares the edge index of p
+*/
+IsoLinePoly& IsoLinePoly::operator=(const IsoLinePoly& p)
+{
+	Polygon2::operator=(p);
+	h = p.h;
+	edgeIndex.store(p.edgeIndex.load());
+	return *this;
+}
+
 /*!
 \brief Return the height of the iso.
 */
@@ -116,24 +136,130 @@ bool IsoLinePoly::IsTrigo() const
 
 /*!
 \brief Return true if two segments of the polygon intersect each other. A polygon with flat borders will return true to this
+
+Shamos-Hoey sweep line in O(n log n): segments are swept from left to right and kept sorted from bottom to top in a status,
+the leftmost intersection is always between two segments which are neighbours in the status at some point, so only neighbours are tested.
+Two consecutive segments are never tested together since they share a vertex.
 */
 bool IsoLinePoly::IsAutoIntersecting() const
 {
 	int n = q.size();
-	for (int i = 0; i < n; i++)
+
+	// With 3 segments or less, all pairs are consecutive
+	if (n < 4)
+		return false;
+
+	auto lexLess = [](const Vector2& a, const Vector2& b) { return a[0] < b[0] || (a[0] == b[0] && a[1] < b[1]); };
+	auto orient = [](const Vector2& a, const Vector2& b, const Vector2& c) { return (b[0] - a[0]) * (c[1] - a[1]) - (b[1] - a[1]) * (c[0] - a[0]); };
+
+	// Segment i goes from q[i] to q[i + 1], stored here from its left to its right end
+	QVector<Vector2> left(n), right(n);
+	for (int i = 0; i < n; ++i)
+	{
+		left[i] = q.at(i);
+		right[i] = q.at((i + 1) % n);
+		if (lexLess(right[i], left[i]))
+			std::swap(left[i], right[i]);
+	}
+
+	// Order of the status: true if s is below t, the side is taken where the segment starting last begins (segments do not cross before the first intersection)
+	auto below = [&](int s, int t)
 	{
+		if (s == t)
+			return false;
+
+		if (!lexLess(left[t], left[s]))
+		{
+			double o = orient(left[s], right[s], left[t]);
+			if (o == 0)
+				o = orient(left[s], right[s], right[t]);
+			if (o != 0)
+				return o > 0;
+		}
+		else
+		{
+			double o = orient(left[t], right[t], left[s]);
+			if (o == 0)
+				o = orient(left[t], right[t], right[s]);
+			if (o != 0)
+				return o < 0;
+		}
+		return s < t;
+	};
+
+	auto intersect = [&](int i, int j)
+	{
+		if (i == (j + 1) % n || j == (i + 1) % n)
+			return false;
+
 		Segment2 s1(q.at(i), q.at((i + 1) % n));
+		Segment2 s2(q.at(j), q.at((j + 1) % n));
+		return s1.Intersect(s2);
+	};
 
-		for (int j = 0; j < n; j++)
+	// Event 2 * i is the left end of segment i, 2 * i + 1 its right end
+	// At the same point, segments are inserted before being removed so that touching segments are tested
+	QVector<int> events(2 * n);
+	for (int e = 0; e < 2 * n; ++e)
+		events[e] = e;
+	std::sort(events.begin(), events.end(), [&](int a, int b)
+	{
+		const Vector2& pa = a % 2 == 0 ? left[a / 2] : right[a / 2];
+		const Vector2& pb = b % 2 == 0 ? left[b / 2] : right[b / 2];
+		if (lexLess(pa, pb))
+			return true;
+		if (lexLess(pb, pa))
+			return false;
+		if (a % 2 != b % 2)
+			return a % 2 == 0;
+		return a < b;
+	});
+
+	using Status = std::set<int, decltype(below)>;
+	Status status(below);
+	QVector<Status::iterator> where(n);
+
+	// Neighbours of a position in the status, we take 3 on each side: a consecutive segment (not tested) which overlaps
+	// a flat border can hide the real neighbour, and a segment has only 2 consecutive segments
+	auto lower = [&status](Status::iterator it)
+	{
+		QVector<int> segs;
+		while (it != status.begin() && segs.size() < 3)
+			segs.append(*(--it));
+		return segs;
+	};
+	auto upper = [&status](Status::iterator it)
+	{
+		QVector<int> segs;
+		while (++it != status.end() && segs.size() < 3)
+			segs.append(*it);
+		return segs;
+	};
+
+	for (int e : events)
+	{
+		int s = e / 2;
+		if (e % 2 == 0)
 		{
-			if (i != j && i != (j + 1) % n && i != (j + n - 1) % n)
-			{
-				Segment2 s2(q.at(j), q.at((j + 1) % n));
-				if (s1.Intersect(s2))
-				{
+			Status::iterator it = status.insert(s).first;
+			where[s] = it;
+
+			for (int t : lower(it))
+				if (intersect(t, s))
+					return true;
+			for (int t : upper(it))
+				if (intersect(t, s))
 					return true;
-				}
-			}
+		}
+		else
+		{
+			Status::iterator it = where[s];
+			QVector<int> up = upper(it);
+			for (int t : lower(it))
+				for (int u : up)
+					if (intersect(t, u))
+						return true;
+			status.erase(it);
 		}
 	}
 	return false;
@@ -431,17 +557,27 @@ IsoLinePoly IsoLinePoly::DisplacementTowardCurve(const PointCurve2& c, double r,
 \brief Returns if the given polygon intersects with this polygon, and if not, which one contains the other.
 
 \todo Pass this function into Polygon2 class
-	  Actuellement en O(n^2)
-	  Peut tre amlior avec l'algorithme de Bentley-Ottmann en O((n + m)log(n + m))
+
+Disjoint boxes are answered immediately. Otherwise each edge of p is only tested against the edges of this polygon
+whose box it overlaps, through the cached edge hierarchy (O(m log n) instead of O(n m)).
 
 \param p The polygon for comparison.
 */
 IsoLinePoly::IntersectType IsoLinePoly::RelationWith(const Polygon2& p) const
 {
-	for (int i = 0; i < q.size(); i++)
+	const EdgeIndex& index = Index();
+
+	// Botes disjointes : pas d'intersection, et aucun des deux ne peut contenir un sommet de l'autre
+	Box2 pbox = p.GetBox();
+	if (pbox[1][0] < index.box[0][0] || pbox[0][0] > index.box[1][0] || pbox[1][1] < index.box[0][1] || pbox[0][1] > index.box[1][1])
+	{
+		return IntersectType::INDEPENDENT;
+	}
+
+	int m = p.Size();
+	for (int i = 0; i < m; i++)
 	{
-		Segment2 ab(q.at(i), q.at((i + 1) % q.size()));
-		if (p.Intersect(ab))
+		if (index.bvh.Intersect(p.Vertex(i), p.Vertex((i + 1) % m)))
 		{
 			return IntersectType::INTERSECT;
 		}
@@ -464,6 +600,63 @@ IsoLinePoly::IntersectType IsoLinePoly::RelationWith(const Polygon2& p) const
 	return IntersectType::INDEPENDENT;
 }
 
+/*!
+\brief Build the edge index used by RelationWith now, allows to build the indices of several polygons in parallel before using them
+*/
+void IsoLinePoly::BuildEdgeIndex() const
+{
+	Index();
+}
+
+/*!
+\brief Same as Inside, with a crossing number computed through the edge hierarchy (O(log n) instead of O(n))
+*/
+bool IsoLinePoly::InsideIndexed(const Vector2& p) const
+{
+	return Index().bvh.Inside(p);
+}
+
+/*!
+\brief Distance between p and the polygon, through the edge hierarchy (O(log n) instead of O(n))
+\param bound When the distance is bigger than bound, any value >= bound can be returned (allows to stop the search early)
+*/
+double IsoLinePoly::DistanceIndexed(const Vector2& p, double bound) const
+{
+	return Index().bvh.Distance(p, bound);
+}
+
+/*!
+\brief Same as Signed (negative inside), through the edge hierarchy
+*/
+double IsoLinePoly::SignedIndexed(const Vector2& p) const
+{
+	const EdgeIndex& index = Index();
+	double d = index.bvh.Distance(p);
+	return index.bvh.Inside(p) ? -d : d;
+}
+
+/*!
+\brief Return the box and the edge hierarchy of the polygon, rebuilt when the vertices changed since the last call
+Thread safe: threads rebuilding the index at the same time all end up with the one published first (the others are dropped).
+*/
+const IsoLinePoly::EdgeIndex& IsoLinePoly::Index() const
+{
+	std::shared_ptr<const EdgeIndex> current = edgeIndex.load();
+	while (!current || current->vertices.constData() != q.constData() || current->vertices.size() != q.size())
+	{
+		std::shared_ptr<EdgeIndex> index = std::make_shared<EdgeIndex>();
+		index->vertices = q;
+		index->box = GetBox();
+		index->bvh = SegmentBVH(*this);
+
+		// En cas d'chec, current devient l'index publi par un autre thread entre temps
+		std::shared_ptr<const EdgeIndex> built = index;
+		if (edgeIndex.compare_exchange_strong(current, built))
+			current = built;
+	}
+	return *current;
+}
+
 /*
 \brief Compute the normal of one vertex of a polygon according to its neighbours.
 
@@ -595,9 +788,13 @@ QVector<int> IsoLinePoly::EarClip2() const
 
 IsoLines::IsoLines(const QVector<Polygon2>& polys, double hmin, double hmax, bool simple) : simple(simple)
 {
+	QVector<IsoLinePoly> ilps;
 	for (const Polygon2& p: polys)
+		ilps.append(IsoLinePoly(p));
+
+	for (bool appended : AppendAll(ilps))
 	{
-		if (!Append(IsoLinePoly(p)))
+		if (!appended)
 		{
 			cerr << "A polygon has been discarded from the set, check for collisions." << endl;
 		}
@@ -611,9 +808,13 @@ IsoLines::IsoLines(const QVector<Polygon2>& polys, double hmin, double hmax, boo
 
 IsoLines::IsoLines(const Polygons2& polys, double hmin, double hmax, bool simple) : simple(simple)
 {
+	QVector<IsoLinePoly> ilps;
 	for (int i = 0; i < polys.Size(); ++i)
+		ilps.append(IsoLinePoly(polys.At(i)));
+
+	for (bool appended : AppendAll(ilps))
 	{
-		if (!Append(IsoLinePoly(polys.At(i))))
+		if (!appended)
 		{
 			cerr << "A polygon has been discarded from the set, check for collisions." << endl;
 		}
@@ -627,9 +828,9 @@ IsoLines::IsoLines(const Polygons2& polys, double hmin, double hmax, bool simple
 
 IsoLines::IsoLines(const QVector<IsoLinePoly>& ilps, bool simple) : simple(simple)
 {
-	for (const IsoLinePoly& iso : ilps)
+	for (bool appended : AppendAll(ilps))
 	{
-		if (!Append(iso))
+		if (!appended)
 		{
 			cerr << "An iso has been discarded from the set, check for collisions." << endl;
 		}
@@ -666,6 +867,11 @@ IsoLines::IsoLines(const ScalarField2& sf, const QSet<double>& heights, bool sim
 			h = h + (max - min) / (heights.size() * 100); // Attention, petit epsilon qui ne marche pas ncessairement avec tous les terrains, mais suffisant pour l'instant
 	// Fin correction
 
+	// 1. Extraction et nettoyage de chaque niveau en parallle (les niveaux sont indpendants)
+	QVector<QVector<IsoLinePoly>> levels(n);
+	QVector<IsoLinePoly>* levelIsos = levels.data();
+
+	#pragma omp parallel for schedule(dynamic)
 	for (int i = 0; i < n; ++i)
 	{
 		double h = values[i];
@@ -682,12 +888,20 @@ IsoLines::IsoLines(const ScalarField2& sf, const QSet<double>& heights, bool sim
 
 			// On ne garde que les grosses isos
 			if (ilp.Size() > 10)
-			{
-				if (!Append(ilp))
-				{
-					cerr << "An iso has been created from hf but has been discarded, not normal." << endl;
-				}
-			}
+				levelIsos[i].append(ilp);
+		}
+	}
+
+	// 2. Construction de la hirarchie en une fois, dans l'ordre des niveaux
+	QVector<IsoLinePoly> candidates;
+	for (const QVector<IsoLinePoly>& level : levels)
+		candidates.append(level);
+
+	for (bool appended : AppendAll(candidates))
+	{
+		if (!appended)
+		{
+			cerr << "An iso has been created from hf but has been discarded, not normal." << endl;
 		}
 	}
 
@@ -725,13 +939,25 @@ IsoLines::IsoLines(const GraphPoisson& gp, const HistogramD& histo, bool simple)
 	double a, b;
 	gp.GetRange(a, b);
 
-	for (double h : heights)
+	// 1. Tous les niveaux en une seule passe (extraits en parallle)
+	QVector<Polygons2> contours = gp.ContourLines(heights);
+
+	// 2. Construction de la hirarchie en une fois, dans l'ordre des niveaux
+	QVector<IsoLinePoly> candidates;
+	for (int k = 0; k < heights.size(); ++k)
 	{
-		Polygons2 polys = gp.ContourLines(h);
-		for (int j = 0; j < polys.Size(); ++j)
+		for (int j = 0; j < contours[k].Size(); ++j)
+			candidates.append(IsoLinePoly(contours[k].At(j), heights[k]));
+	}
+	QVector<bool> appended = AppendAll(candidates);
+
+	int c = 0;
+	for (int k = 0; k < heights.size(); ++k)
+	{
+		const Polygons2& polys = contours[k];
+		for (int j = 0; j < polys.Size(); ++j, ++c)
 		{
-			IsoLinePoly ilp(polys.At(j), h);
-			if (!Append(ilp))
+			if (!appended[c])
 			{
 				cerr << "An iso has been created from graph poisson but has been discarded, not normal." << endl;
 			}
@@ -739,7 +965,7 @@ IsoLines::IsoLines(const GraphPoisson& gp, const HistogramD& histo, bool simple)
 
 		if (polys.Size() == 0)
 		{
-			qDebug() << "There is no isoline extracted for height" << h;
+			qDebug() << "There is no isoline extracted for height" << heights[k];
 		}
 	}
 
@@ -747,6 +973,71 @@ IsoLines::IsoLines(const GraphPoisson& gp, const HistogramD& histo, bool simple)
 		cerr << "ill-formed graphpoisson" << endl;
 }
 
+/*!
+\brief Compare the set with a previous version of itself, to know which part of the plane is touched by the modification
+\param previous The set before the modification
+\param changed (out) indices of the isos whose vertices changed
+\param region (out) box of the edges which moved (before and after the modification), Box2::Null if nothing changed
+\return false if the modification is not local: the isos, their hierarchy or their heights are not the same anymore
+*/
+bool IsoLines::ChangedRegion(const IsoLines& previous, QVector<int>& changed, Box2& region) const
+{
+	changed.clear();
+	region = Box2::Null;
+	if (simple != previous.simple || isos.size() != previous.isos.size() || parents != previous.parents)
+		return false;
+
+	double xmin = Math::Infinity, ymin = Math::Infinity;
+	double xmax = -Math::Infinity, ymax = -Math::Infinity;
+	auto extend = [&](const Vector2& v) {
+		xmin = Math::Min(xmin, v[0]);
+		ymin = Math::Min(ymin, v[1]);
+		xmax = Math::Max(xmax, v[0]);
+		ymax = Math::Max(ymax, v[1]);
+	};
+
+	for (int i = 0; i < isos.size(); ++i)
+	{
+		const IsoLinePoly& a = isos[i];
+		const IsoLinePoly& b = previous.isos[i];
+		if (a.H() != b.H())
+			return false;
+
+		// Nombre de sommets diffrent : on prend tout le polygone, avant et aprs
+		if (a.Size() != b.Size())
+		{
+			changed.append(i);
+			for (int k = 0; k < a.Size(); ++k)
+				extend(a.Vertex(k));
+			for (int k = 0; k < b.Size(); ++k)
+				extend(b.Vertex(k));
+			continue;
+		}
+
+		// Sinon seulement les artes autour des sommets qui ont boug
+		int m = a.Size();
+		bool modified = false;
+		for (int k = 0; k < m; ++k)
+		{
+			if (a.Vertex(k)[0] == b.Vertex(k)[0] && a.Vertex(k)[1] == b.Vertex(k)[1])
+				continue;
+
+			modified = true;
+			for (int l = k - 1; l <= k + 1; ++l)
+			{
+				extend(a.Vertex((l + m) % m));
+				extend(b.Vertex((l + m) % m));
+			}
+		}
+		if (modified)
+			changed.append(i);
+	}
+
+	if (!changed.isEmpty())
+		region = Box2(Vector2(xmin, ymin), Vector2(xmax, ymax));
+	return true;
+}
+
 Box2 IsoLines::GetBox() const
 {
 	Box2 b = Box2::Null;
@@ -1082,6 +1373,9 @@ void IsoLines::ResampleSpline(double distMax, double card)
 */
 bool IsoLines::Inside(const Vector2& p) const
 {
+	if (CurrentPointIndex() != nullptr)
+		return ComputeParentIso(p) != -1;
+
 	// We only check the roots isolines since every other are contained inside those one
 	for (int i : Roots())
 		if (isos[i].Inside(p))
@@ -1089,14 +1383,190 @@ bool IsoLines::Inside(const Vector2& p) const
 	return false;
 }
 
+/*!
+\brief Build the edge index of every isoline (in parallel), the copies made afterwards share it
+Not needed for correctness, but avoids building the same index in each thread querying an isoline
+*/
+void IsoLines::BuildEdgeIndices() const
+{
+	const IsoLinePoly* polys = isos.constData();
+
+	#pragma omp parallel for schedule(dynamic)
+	for (int i = 0; i < isos.size(); ++i)
+	{
+		polys[i].BuildEdgeIndex();
+	}
+}
+
+/*!
+\brief Build a grid over the isolines so that ComputeParentIso(const Vector2&) does not descend the hierarchy anymore
+\warn Do not work when simple = true
+
+Each cell knows the innermost iso containing it entirely, and the isos whose boundary may cross it.
+A point in a cell without boundary gets its parent immediately, otherwise only the isos crossing its cell are tested (through their edge hierarchy).
+The grid is used as long as the isolines are not modified, any modification makes it out of date and ComputeParentIso descends the hierarchy again.
+
+\param resolution Number of cells along the longest side of the box of the isolines
+*/
+void IsoLines::BuildPointIndex(int resolution) const
+{
+	pointIndex.reset();
+	if (simple || isos.isEmpty())
+		return;
+
+	// Construit avant la copie pour que les isos de l'ensemble partagent aussi leur index
+	BuildEdgeIndices();
+
+	QSharedPointer<PointIndex> index = QSharedPointer<PointIndex>::create();
+	index->isos = isos;
+	const IsoLinePoly* polys = index->isos.constData();
+	int n = isos.size();
+
+	Box2 box = GetBox();
+	Vector2 size = box[1] - box[0];
+	index->cell = Math::Max(size[0], size[1]) / resolution;
+	if (index->cell <= 0)
+		index->cell = 1;
+	index->origin = box[0];
+	index->nx = Math::Max(1, int(ceil(size[0] / index->cell)));
+	index->ny = Math::Max(1, int(ceil(size[1] / index->cell)));
+	int nx = index->nx;
+	int ny = index->ny;
+
+	// Profondeur de chaque iso dans l'arbre
+	index->depth = QVector<int>(n, 0);
+	QVector<int>& depth = index->depth;
+	for (int i = 0; i < n; ++i)
+	{
+		for (int j = parents[i]; j != -1; j = parents[j])
+			depth[i]++;
+	}
+
+	// Cellules touches par la bote de chaque arte (conservatif)
+	auto clampX = [&](double x) { return Math::Min(Math::Max(int(floor((x - index->origin[0]) / index->cell)), 0), nx - 1); };
+	auto clampY = [&](double y) { return Math::Min(Math::Max(int(floor((y - index->origin[1]) / index->cell)), 0), ny - 1); };
+
+	QVector<int> stamp(nx * ny, -1);
+	QVector<QPair<int, int>> crossings;
+	for (int i = 0; i < n; ++i)
+	{
+		const IsoLinePoly& iso = polys[i];
+		int m = iso.Size();
+		for (int k = 0; k < m; ++k)
+		{
+			Vector2 a = iso.Vertex(k);
+			Vector2 b = iso.Vertex((k + 1) % m);
+			int x0 = clampX(Math::Min(a[0], b[0]));
+			int x1 = clampX(Math::Max(a[0], b[0]));
+			int y0 = clampY(Math::Min(a[1], b[1]));
+			int y1 = clampY(Math::Max(a[1], b[1]));
+			for (int y = y0; y <= y1; ++y)
+			{
+				for (int x = x0; x <= x1; ++x)
+				{
+					int c = x + nx * y;
+					if (stamp[c] != i)
+					{
+						stamp[c] = i;
+						crossings.append(qMakePair(c, i));
+					}
+				}
+			}
+		}
+	}
+
+	// Les isos de chaque cellule, de la plus profonde  la plus haute
+	std::sort(crossings.begin(), crossings.end(), [&depth](const QPair<int, int>& u, const QPair<int, int>& v) {
+		if (u.first != v.first)
+			return u.first < v.first;
+		return depth[u.second] > depth[v.second];
+	});
+
+	index->offsets = QVector<int>(nx * ny + 1, 0);
+	index->boundaries.reserve(crossings.size());
+	for (const QPair<int, int>& cr : crossings)
+	{
+		index->offsets[cr.first + 1]++;
+		index->boundaries.append(cr.second);
+	}
+	for (int c = 0; c < nx * ny; ++c)
+		index->offsets[c + 1] += index->offsets[c];
+
+	// Iso contenant toute la cellule : on remonte depuis l'iso du centre tant qu'elle traverse la cellule
+	QVector<double> xs(nx), ys(ny);
+	for (int x = 0; x < nx; ++x)
+		xs[x] = index->origin[0] + (x + 0.5) * index->cell;
+	for (int y = 0; y < ny; ++y)
+		ys[y] = index->origin[1] + (y + 0.5) * index->cell;
+	index->base = ComputeParentIsos(xs, ys);
+
+	for (int c = 0; c < nx * ny; ++c)
+	{
+		const int* first = index->boundaries.constData() + index->offsets[c];
+		const int* last = index->boundaries.constData() + index->offsets[c + 1];
+		int parent = index->base[c];
+		while (parent != -1 && std::find(first, last, parent) != last)
+			parent = parents[parent];
+		index->base[c] = parent;
+	}
+
+	pointIndex = index;
+}
+
+/*!
+\brief Return the grid built by BuildPointIndex, nullptr if it does not exist or if the isolines changed since it was built
+*/
+const IsoLines::PointIndex* IsoLines::CurrentPointIndex() const
+{
+	if (pointIndex.isNull() || pointIndex->isos.constData() != isos.constData() || pointIndex->isos.size() != isos.size())
+		return nullptr;
+	return pointIndex.data();
+}
+
 /*!
 \brief Compute the parent isoline of a point in space
 \warn Do not work when simple = true
 
+Answered by the grid of BuildPointIndex when it is up to date, by a descent of the hierarchy otherwise.
+
 \param p	the point
 \return		the parent index or -1 if the point is outside the isolines
 */
 int IsoLines::ComputeParentIso(const Vector2& p) const
+{
+	const PointIndex* index = CurrentPointIndex();
+	if (index != nullptr)
+	{
+		double x = (p[0] - index->origin[0]) / index->cell;
+		double y = (p[1] - index->origin[1]) / index->cell;
+		if (x < 0 || y < 0 || x > index->nx || y > index->ny)
+			return -1;
+
+		int c = Math::Min(int(x), index->nx - 1) + index->nx * Math::Min(int(y), index->ny - 1);
+
+		// La plus profonde des isos qui traversent la cellule et contiennent le point, sinon celle qui contient la cellule
+		// Les artes sont ranges par leur bote : une iso peut tre liste alors qu'elle contient toute la cellule, et tre un anctre de base[c]
+		// On ne garde donc une iso liste que si elle est plus profonde que base[c]
+		int base = index->base[c];
+		int baseDepth = base == -1 ? -1 : index->depth[base];
+		for (int k = index->offsets[c]; k < index->offsets[c + 1]; ++k)
+		{
+			int i = index->boundaries[k];
+			if (index->depth[i] <= baseDepth)
+				break;
+			if (index->isos[i].InsideIndexed(p))
+				return i;
+		}
+		return base;
+	}
+
+	return ComputeParentIsoDescent(p);
+}
+
+/*!
+\brief Compute the parent isoline of a point by a descent of the hierarchy, from the roots
+*/
+int IsoLines::ComputeParentIsoDescent(const Vector2& p) const
 {
 	int parent = -1;
 
@@ -1156,6 +1626,127 @@ bool IsoLines::ComputeParentIso(const Polygon2& p, int& parent) const
 	return true;
 }
 
+/*!
+\brief Compute the parent isoline of every point of a grid, same result as calling ComputeParentIso on each point
+\warn Do not work when simple = true
+
+Each iso is filled once with a scanline (active edge table), parents before children.
+A point only takes the iso if it already has the iso parent, exactly like the descent of ComputeParentIso.
+
+\param xs	the x coordinates of the grid columns, in increasing order
+\param ys	the y coordinates of the grid rows
+\return	the parent index of point (xs[i], ys[j]) in i + xs.size() * j, -1 if the point is outside the isolines
+*/
+QVector<int> IsoLines::ComputeParentIsos(const QVector<double>& xs, const QVector<double>& ys) const
+{
+	int w = xs.size();
+	int h = ys.size();
+	QVector<int> result(w * h, -1);
+
+	// Rows sorted by y, so that the edges enter and leave the active table only once
+	QVector<int> rows(h);
+	for (int j = 0; j < h; ++j)
+		rows[j] = j;
+	std::sort(rows.begin(), rows.end(), [&ys](int a, int b) { return ys[a] < ys[b]; });
+
+	// Parents first: breadth first traversal of the tree
+	QVector<int> queue(roots.begin(), roots.end());
+	for (int q = 0; q < queue.size(); ++q)
+	{
+		int iso = queue[q];
+		for (int c : children[iso])
+			queue.append(c);
+
+		const IsoLinePoly& poly = isos[iso];
+		int n = poly.Size();
+		int parent = parents[iso];
+
+		// Edge (k, k - 1) as in the point in polygon test, sorted by the lowest y
+		QVector<int> edges(n);
+		QVector<double> ymin(n), ymax(n);
+		for (int k = 0; k < n; ++k)
+		{
+			edges[k] = k;
+			double ya = poly.Vertex(k)[1];
+			double yb = poly.Vertex((k + n - 1) % n)[1];
+			ymin[k] = Math::Min(ya, yb);
+			ymax[k] = Math::Max(ya, yb);
+		}
+		std::sort(edges.begin(), edges.end(), [&ymin](int a, int b) { return ymin[a] < ymin[b]; });
+
+		QVector<int> active;
+		QVector<double> crossings;
+		int next = 0;
+		for (int j : rows)
+		{
+			double y = ys[j];
+
+			// Update the active edges: those with ymin <= y < ymax
+			while (next < n && ymin[edges[next]] <= y)
+				active.append(edges[next++]);
+			for (int e = active.size() - 1; e >= 0; --e)
+			{
+				if (ymax[active[e]] <= y)
+					active.remove(e);
+			}
+			if (active.isEmpty())
+			{
+				if (next == n)
+					break;
+				continue;
+			}
+
+			crossings.clear();
+			for (int k : active)
+			{
+				Vector2 a = poly.Vertex(k);
+				Vector2 b = poly.Vertex((k + n - 1) % n);
+				if ((a[1] > y) != (b[1] > y))
+					crossings.append((b[0] - a[0]) * (y - a[1]) / (b[1] - a[1]) + a[0]);
+			}
+			std::sort(crossings.begin(), crossings.end());
+
+			// A point is inside when an odd number of crossings is strictly on its right, ie when crossings[2k] <= x < crossings[2k + 1]
+			for (int k = 0; k + 1 < crossings.size(); k += 2)
+			{
+				int first = std::lower_bound(xs.begin(), xs.end(), crossings[k]) - xs.begin();
+				int last = std::lower_bound(xs.begin(), xs.end(), crossings[k + 1]) - xs.begin();
+				for (int i = first; i < last; ++i)
+				{
+					if (result[i + w * j] == parent)
+						result[i + w * j] = iso;
+				}
+			}
+		}
+	}
+
+	return result;
+}
+
+/*!
+\brief Everything Append can compute on a polygon without knowing the set, done in parallel on all the polygons
+
+Checks auto-intersections and builds the edge index of each polygon (used by RelationWith once the polygon is in the set).
+The polygons are then appended one by one in their order with Insert, so the hierarchy is exactly the one of successive Append.
+
+\return for each polygon, false if it is auto-intersecting (Append would refuse it)
+*/
+QVector<bool> IsoLines::PrepareAppend(const QVector<IsoLinePoly>& ilps) const
+{
+	int n = ilps.size();
+	QVector<bool> valid(n, false);
+	bool* v = valid.data();
+
+	#pragma omp parallel for schedule(dynamic)
+	for (int i = 0; i < n; ++i)
+	{
+		v[i] = !ilps[i].IsAutoIntersecting();
+		ilps[i].BuildEdgeIndex();
+	}
+
+	return valid;
+}
+
 /*!
 \brief Add a polygon as an isoline and automatically set its heights according to the neighbourhood
 \warn When simple = true, the polygon value is the base value (which correspond to the value given for the first polygon)
@@ -1224,11 +1815,18 @@ We do not check if the set is well-formed at each Append since multiple append m
 */
 bool IsoLines::Append(const IsoLinePoly& ilp)
 {
-	// We only want non intersecting polygon for isolines
-	// /!\ QUADRATIC, be careful with big polygons. TODO: improve this algo (using a sweeping line?)
+	// We only want non intersecting polygon for isolines (sweep line, O(n log n))
 	if (ilp.IsAutoIntersecting())
 		return false;
 
+	return Insert(ilp);
+}
+
+/*!
+\brief Same as Append, for an isoline already known to be non auto-intersecting (see PrepareAppend)
+*/
+bool IsoLines::Insert(const IsoLinePoly& ilp)
+{
 	if (simple)
 	{
 		isos.append(ilp);
@@ -1309,6 +1907,162 @@ bool IsoLines::Append(const IsoLinePoly& ilp)
 	return true;
 }
 
+/*!
+\brief Add several isolines at once, same result as calling Append on each of them in order
+\warn When simple = true, the isolines are always appended (if they are not auto-intersecting)
+
+Append descends the hierarchy and rescans the siblings for every new isoline, which is quadratic when building a whole set.
+Here every isoline is compared once with the isolines whose box overlaps its box (sweep on the boxes sorted by x), in parallel:
+an isoline is refused if it crosses an isoline accepted before it, and its parent is the smallest accepted isoline which contains it.
+The hierarchy is then rebuilt in one pass, the isolines already in the set are kept first.
+
+\return for each isoline, true if it has been appended
+*/
+QVector<bool> IsoLines::AppendAll(const QVector<IsoLinePoly>& ilps)
+{
+	QVector<bool> valid = PrepareAppend(ilps);
+
+	if (simple)
+	{
+		for (int i = 0; i < ilps.size(); ++i)
+		{
+			if (valid[i])
+				Insert(ilps[i]);
+		}
+		return valid;
+	}
+
+	// Les isos dj prsentes sont en tte et toujours gardes
+	int e = isos.size();
+	QVector<IsoLinePoly> all = isos + ilps;
+	const IsoLinePoly* polys = all.constData();
+	int n = all.size();
+
+	QVector<bool> candidate(n, true);
+	for (int i = e; i < n; ++i)
+		candidate[i] = valid[i - e];
+
+	QVector<Box2> boxes(n, Box2::Null);
+	QVector<double> areas(n);
+	Box2* b = boxes.data();
+	double* ar = areas.data();
+
+	#pragma omp parallel for schedule(dynamic)
+	for (int i = 0; i < n; ++i)
+	{
+		b[i] = polys[i].GetBox();
+		ar[i] = Math::Abs(polys[i].SignedArea());
+		polys[i].BuildEdgeIndex();
+	}
+
+	// Balayage des botes selon x : paires (i, j), i < j, dont les botes se recouvrent
+	QVector<int> order;
+	for (int i = 0; i < n; ++i)
+	{
+		if (candidate[i])
+			order.append(i);
+	}
+	std::sort(order.begin(), order.end(), [&boxes](int i, int j) { return boxes[i][0][0] < boxes[j][0][0]; });
+
+	QVector<QPair<int, int>> pairs;
+	for (int k = 0; k < order.size(); ++k)
+	{
+		int i = order[k];
+		for (int l = k + 1; l < order.size() && boxes[order[l]][0][0] <= boxes[i][1][0]; ++l)
+		{
+			int j = order[l];
+			if (boxes[j][1][1] < boxes[i][0][1] || boxes[j][0][1] > boxes[i][1][1])
+				continue;
+			pairs.append(i < j ? qMakePair(i, j) : qMakePair(j, i));
+		}
+	}
+
+	// Relation de chaque paire, calcule comme dans Append (l'iso la plus ancienne avec la nouvelle)
+	int np = pairs.size();
+	QVector<IsoLinePoly::IntersectType> relations(np);
+	IsoLinePoly::IntersectType* r = relations.data();
+
+	#pragma omp parallel for schedule(dynamic)
+	for (int k = 0; k < np; ++k)
+	{
+		r[k] = polys[pairs[k].first].RelationWith(polys[pairs[k].second]);
+	}
+
+	QVector<QVector<int>> pairsOf(n);
+	for (int k = 0; k < np; ++k)
+	{
+		pairsOf[pairs[k].first].append(k);
+		pairsOf[pairs[k].second].append(k);
+	}
+
+	// Une iso est refuse si elle croise une iso accepte avant elle
+	QVector<bool> accepted(n, false);
+	for (int i = 0; i < n; ++i)
+	{
+		if (!candidate[i])
+			continue;
+
+		accepted[i] = true;
+		if (i < e)
+			continue;
+
+		for (int k : pairsOf[i])
+		{
+			if (pairs[k].second == i && relations[k] == IsoLinePoly::INTERSECT && accepted[pairs[k].first])
+			{
+				accepted[i] = false;
+				break;
+			}
+		}
+	}
+
+	// Nouveaux indices, dans l'ordre
+	QVector<int> index(n, -1);
+	int m = 0;
+	for (int i = 0; i < n; ++i)
+	{
+		if (accepted[i])
+			index[i] = m++;
+	}
+
+	// Parent : la plus petite iso accepte qui contient l'iso
+	isos.clear();
+	parents = QVector<int>(m, -1);
+	children = QVector<QSet<int>>(m);
+	roots.clear();
+	for (int i = 0; i < n; ++i)
+	{
+		if (!accepted[i])
+			continue;
+
+		isos.append(polys[i]);
+
+		int parent = -1;
+		for (int k : pairsOf[i])
+		{
+			int j = pairs[k].first == i ? pairs[k].second : pairs[k].first;
+			if (!accepted[j])
+				continue;
+
+			bool contains = (j == pairs[k].first) ? relations[k] == IsoLinePoly::CONTAINS : relations[k] == IsoLinePoly::INSIDE;
+			if (contains && (parent == -1 || areas[j] < areas[parent]))
+				parent = j;
+		}
+
+		if (parent == -1)
+		{
+			roots.insert(index[i]);
+		}
+		else
+		{
+			parents[index[i]] = index[parent];
+			children[index[parent]].insert(index[i]);
+		}
+	}
+
+	return accepted.mid(e);
+}
+
 /*!
 \brief Remove the isoline of index ind, if recursive is set to true, remove every child of this iso
 \warn recursive as no meaning when simple = true
@@ -1506,12 +2260,18 @@ ScalarField2 IsoLines::GetMask(const Box2& box, int w, int h) const
 	a -= step;
 
 	ScalarField2 mask(box, w, h, 0);
+	QVector<double> xs(mask.GetSizeX()), ys(mask.GetSizeY());
+	for (int x = 0; x < xs.size(); ++x)
+		xs[x] = mask.ArrayVertex(x, 0)[0];
+	for (int y = 0; y < ys.size(); ++y)
+		ys[y] = mask.ArrayVertex(0, y)[1];
+	QVector<int> parentIsos = ComputeParentIsos(xs, ys);
+
 	for (int x = 0; x < mask.GetSizeX(); ++x)
 	{
 		for (int y = 0; y < mask.GetSizeY(); ++y)
 		{
-			Vector2 c = mask.ArrayVertex(x, y);
-			int iso = ComputeParentIso(c);
+			int iso = parentIsos[x + xs.size() * y];
 			if (iso != -1)
 			{
 				double h = (isos[iso].H() - a) / (b - a);
@@ -66,18 +66,29 @@ void IsoVectoGenerationV1::PreProcess()
 	// RAZ
 	nbAssigned = 0;
 	lastChosen = -1;
+	borders = EdenFrontier(R.Size());
 
+	QVector<int> seaBorders;
 	for (int nodeId = 0; nodeId < R.Size(); ++nodeId)
 	{
 		// Toutes les bordures font directement partie de la premire iso
 		if (R.IsBorder(nodeId))
 		{
-			borders.insert(nodeId);
+			seaBorders.append(nodeId);
 			R[nodeId] = GetNextHeight();
 		}
+		else
+		{
+			borders.SetFree(nodeId);
+		}
 	}
 
-	if (borders.isEmpty())
+	for (int nodeId : seaBorders)
+	{
+		borders.AddBorder(R, nodeId, P[nodeId]);
+	}
+
+	if (borders.IsEmpty())
 	{
 		cerr << "[Version 1] There is no border in the zone, this is not possible to grow. Undefined results." << endl;
 	}
@@ -86,45 +97,23 @@ void IsoVectoGenerationV1::PreProcess()
 #include "cpu.h"
 void IsoVectoGenerationV1::ChooseNextNode()
 {
-	static Random r;
-	while (true)
-	{
-		// On rcupre un lment de bordure
-		int parent = GetRandomNode();
+	// On rcupre un lment de bordure
+	int parent = GetRandomNode();
 
-		if (parent == -1)
-		{
-			cerr << "[Version 1] Impossible to keep growing, no border remains" << endl;
-			//System::SaveSvg(R.ToScene(), "Figures/test.svg");
-			exit(1);
-		}
+	if (parent == -1)
+	{
+		cerr << "[Version 1] Impossible to keep growing, no border remains" << endl;
+		//System::SaveSvg(R.ToScene(), "Figures/test.svg");
+		exit(1);
+	}
 
-		// On choisit un des voisins de manire alatoire
-		QVector<int> neighs;
-		for (int neigh : R.Neighbours(parent))
-		{
-			if (R[neigh] == INITIAL_VALUE)
-			{
-				neighs.append(neigh);
-			}
-		}
+	// On choisit un des voisins non assigns de manire alatoire
+	// Un noeud est dans la bordure tant qu'il a au moins un voisin non choisi, il en a donc forcment un
+	lastChosen = borders.FreeNeighbour(R, parent, neighbourRandom.Integer(borders.FreeNeighbours(parent)));
+	R[lastChosen] = GetNextHeight();
 
-		// Un noeud est dans la bordure s'il a au moins un voisin non choisi
-		// On enlve un noeud de l'ensemble des bordures que lorsqu'on le choisi alatoirement et qu'on se rend compte que tous les voisins sont choisis
-		// TODO: c'est sans doute plus rapide de garder le set le plus petit possible  chaque fois, mais c'est plus clair et plus rapide  coder comme a
-		if (!neighs.empty())
-		{
-			lastChosen = neighs[r.Integer(neighs.size())];
-			R[lastChosen] = GetNextHeight();
-			borders.insert(lastChosen);
-			return;
-		}
-		else
-		{
-			// On n'est plus dans la bordure si on n'a plus de voisin
-			borders.remove(parent);
-		}
-	}
+	// Met  jour uniquement les voisins de lastChosen (ils sortent de la bordure s'ils n'ont plus de voisin libre)
+	borders.Assign(R, lastChosen, P[lastChosen]);
 }
 
 void IsoVectoGenerationV1::PostProcess()
@@ -132,33 +121,14 @@ void IsoVectoGenerationV1::PostProcess()
 
 }
 
+// Renvoie un noeud alatoire de la bordure, en O(log n) grce  l'arbre des sommes
 int IsoVectoGenerationV1::GetRandomNode()
 {
-	static Random r = Random::R239;
-	double cumul = 0;
-	for (int ind : borders)
-	{
-		cumul += P[ind];
-	}
-
 	// Si aucun point ne peut tre choisi, on n'en choisi pas
-	if (cumul == 0)
+	if (borders.IsEmpty())
 		return -1;
 
-	double p = r.Uniform(0, cumul);
-	for (int ind : borders)
-	{
-		p -= P[ind];
-		if (p <= 0)
-		{
-			//if (cumul < 1)
-				//cout << cumul << " node " << ind << endl;
-			return ind;
-		}
-	}
-
-	std::cerr << "PROBLEM" << std::endl;
-	return 0;
+	return borders.Sample(nodeRandom.Uniform(0, borders.Total()));
 }
 
 // Should only be called when we set the height of a node
@@ -105,7 +105,7 @@ void IsoVectoGenerationV2::PostProcess()
 
 void IsoVectoGenerationV2::CreateBorders()
 {
-	borders.clear();
+	borders = EdenFrontier(Z.Size());
 	currentZoneNodes.clear();
 
 	// On assigne directement les lments proche de la cote
@@ -126,22 +126,22 @@ void IsoVectoGenerationV2::CreateBorders()
 		{
 			currentZoneNodes.insert(nodeId);
 			R[nodeId] = NOT_INIT_ZONE_VALUE;
+			borders.SetFree(nodeId);
 		}
-		// La bordure consiste en les lments de la zone plus basse qui sont au bord d'un lment de la zone actuelle
-		// Lorsque c'est la premire zone, la bordure est constitu des gens dj dfini (d'o le <= et pas <)
-		else if (Z[nodeId] <= currentZone)
+	}
+
+	// La bordure consiste en les lments de la zone plus basse qui sont au bord d'un lment de la zone actuelle
+	// Lorsque c'est la premire zone, la bordure est constitu des gens dj dfini (d'o le <= et pas <)
+	// Un noeud n'entre dans la bordure que s'il a au moins un voisin libre
+	for (int nodeId = 0; nodeId < Z.Size(); ++nodeId)
+	{
+		if (Z[nodeId] <= currentZone && R[nodeId] != NOT_INIT_ZONE_VALUE)
 		{
-			for (int neighId : Z.Neighbours(nodeId))
-			{
-				if (Z[neighId] == currentZone && (R[neighId] == INITIAL_VALUE || R[neighId] == NOT_INIT_ZONE_VALUE))
-				{
-					borders.insert(nodeId);
-				}
-			}
+			borders.AddBorder(Z, nodeId, P[nodeId]);
 		}
 	}
 
-	if (borders.empty())
+	if (borders.IsEmpty())
 	{
 		cerr << "[Version 2] No border in the Eden. Impossible to grow for zone " << currentZone << " without border." << endl;
 	}
@@ -174,80 +174,38 @@ void IsoVectoGenerationV2::NodesAssignments()
 #include "cpu.h"
 bool IsoVectoGenerationV2::ChooseNextNode()
 {
-	static Random r;
-	while (true)
-	{
-		// On rcupre un lment de bordure
-		int parent = GetRandomNode();
+	// On rcupre un lment de bordure
+	int parent = GetRandomNode();
 
-		if (parent == -1)
-		{
-			return false;
-		}
+	if (parent == -1)
+	{
+		return false;
+	}
 
-		// On choisit un des voisins de manire alatoire
-		QVector<int> neighs;
-		for (int neigh : Z.Neighbours(parent))
-		{
-			if (R[neigh] == NOT_INIT_ZONE_VALUE)
-			{
-				neighs.append(neigh);
-			}
-		}
+	// On choisit un des voisins non assigns de manire alatoire
+	// Un noeud est dans la bordure tant qu'il a au moins un voisin non choisi, il en a donc forcment un
+	lastChosen = borders.FreeNeighbour(Z, parent, neighbourRandom.Integer(borders.FreeNeighbours(parent)));
+	R[lastChosen] = GetNextHeight();
 
-		// Un noeud est dans la bordure s'il a au moins un voisin non choisi
-		// On enlve un noeud de l'ensemble des bordures que lorsqu'on le choisi alatoirement et qu'on se rend compte que tous les voisins sont choisis
-		// TODO: c'est sans doute plus rapide de garder le set le plus petit possible  chaque fois, mais c'est plus clair et plus rapide  coder comme a
-		if (!neighs.empty())
-		{
-			lastChosen = neighs[r.Integer(neighs.size())];
-			borders.insert(lastChosen);
-			R[lastChosen] = GetNextHeight();
+	// Met  jour uniquement les voisins de lastChosen (ils sortent de la bordure s'ils n'ont plus de voisin libre)
+	borders.Assign(Z, lastChosen, P[lastChosen]);
 
-			// Permet juste de faire une animation pour chaque choix
-			if (debug > 0 && nbAssigned % debug == 0)
-				ArticleUtils::ArticleGif(R, lastChosen, root);
+	// Permet juste de faire une animation pour chaque choix
+	if (debug > 0 && nbAssigned % debug == 0)
+		ArticleUtils::ArticleGif(R, lastChosen, root);
 
-			return true;
-		}
-		else
-		{
-			// On n'est plus dans la bordure si on n'a plus de voisin
-			borders.remove(parent);
-		}
-	}
+	return true;
 }
 
 
-// Renvoie un noeud alatoire, en fonction des bordures donnes.
+// Renvoie un noeud alatoire, en fonction des bordures donnes (en O(log n) grce  l'arbre des sommes)
 int IsoVectoGenerationV2::GetRandomNode()
 {
-	static Random r = Random::R239;
-	double cumul = 0;
-	for (int ind : borders)
-	{
-		cumul += P[ind];
-	}
-
 	// Si aucun point ne peut tre choisi, on n'en choisi pas
-	if (cumul == 0)
+	if (borders.IsEmpty())
 		return -1;
 
-	double p = r.Uniform(0, cumul);
-	for (int ind : borders)
-	{
-		p -= P[ind];
-		
-		if (p <= 0)
-		{
-			//if (cumul < 1)
-				//cout << cumul << " node " << ind << endl;
-			return ind;
-		}
-	}
-
-	std::cerr << "PROBLEM" << std::endl;
-	return 0;
+	return borders.Sample(nodeRandom.Uniform(0, borders.Total()));
 }
 
 // Should only be called when we set the height of a node
@@ -4,23 +4,26 @@
 using namespace std;
 
 #define INITIAL_VALUE Math::Infinity
+#define INITIAL_STEP std::numeric_limits<int>::max() // INITIAL_VALUE for the int columns, their unset value: GraphColumn::ToGraph gives it back as infinity
 #define NOT_INIT_ZONE_VALUE 99999999 // considering these values are not real height values
 
 /*
- * Les graphes R, Z et P ont la meme topology (celle donne par z)
+ * Les colonnes R, P, TLow, THigh et T sont des valeurs sur la topologie de Z (celle donne par z), les GraphPoisson ne sont crs que pour les rsultats
  *
  * \param z Les diffrentes zones, qu'importe leur valeur, elles seront tries de la plus petite  la plus grande, on va toujours commencer par la plus petite
  * \param p Les valeurs de proba qu'on veut donner. Elles doivent se situer dans l'intervalle [0, 1]
  * \param exactT Permet de dire si on veut suivre exactement T ou non (si oui on peut avoir des zones endoriques)
  */
-IsoVectoGenerationV3::IsoVectoGenerationV3(const GraphPoisson& z, const ScalarField2& p, bool withEndoreicZones) : R(z, INITIAL_VALUE), Z(z), P(z), TLow(z), THigh(z), T(z), withEndoreicZones(withEndoreicZones)
+IsoVectoGenerationV3::IsoVectoGenerationV3(const GraphPoisson& z, const ScalarField2& p, bool withEndoreicZones) : Z(z), R(z, INITIAL_STEP), TLow(z, INITIAL_STEP), THigh(z, INITIAL_STEP), T(z, INITIAL_VALUE), withEndoreicZones(withEndoreicZones)
 {
-	P.SetValueFromScalarField(p);
-	for (int i = 0; i < P.Size(); ++i)
+	GraphPoisson proba(z);
+	proba.SetValueFromScalarField(p);
+	for (int i = 0; i < proba.Size(); ++i)
 	{
 		// Pour viter les erreurs avec des probas nulles
-		P[i] = Math::Min(0.999, Math::Max(0.001, P[i]));
+		proba[i] = Math::Min(0.999, Math::Max(0.001, proba[i]));
 	}
+	P = GraphColumn<float>(proba, std::numeric_limits<float>::infinity(), INITIAL_VALUE);
 }
 
 /*
@@ -36,12 +39,12 @@ GraphPoisson IsoVectoGenerationV3::Generate(int d, const QString& r)
 	root = r;
 
 	if (debug > 0)
-		ArticleUtils::ArticleGif(R, -1, root);
+		ArticleUtils::ArticleGif(R.ToGraph(Z), -1, root);
 
 	PreProcess();
 
 	if (debug > 0)
-		ArticleUtils::ArticleGif(R, -1, root);
+		ArticleUtils::ArticleGif(R.ToGraph(Z), -1, root);
 
 	while (nbAssigned != R.Size())
 	{
@@ -50,17 +53,17 @@ GraphPoisson IsoVectoGenerationV3::Generate(int d, const QString& r)
 
 	PostProcess();
 
-	return R;
+	return Result();
 }
 
 GraphPoisson IsoVectoGenerationV3::Result() const
 {
-	return R;
+	return R.ToGraph(Z);
 }
 
 GraphPoisson IsoVectoGenerationV3::Proba() const
 {
-	return P;
+	return P.ToGraph(Z);
 }
 
 GraphPoisson IsoVectoGenerationV3::Zones() const
@@ -70,17 +73,26 @@ GraphPoisson IsoVectoGenerationV3::Zones() const
 
 QVector<GraphPoisson> IsoVectoGenerationV3::EdenAsc() const
 {
-	return edenAsc;
+	QVector<GraphPoisson> graphs;
+	for (const GraphColumn<int>& c : edenAsc)
+		graphs.append(c.ToGraph(Z));
+	return graphs;
 }
 
 QVector <GraphPoisson> IsoVectoGenerationV3::EdenDesc() const
 {
-	return edenDesc;
+	QVector<GraphPoisson> graphs;
+	for (const GraphColumn<int>& c : edenDesc)
+		graphs.append(c.ToGraph(Z));
+	return graphs;
 }
 
 QVector <GraphPoisson> IsoVectoGenerationV3::EdenFinal() const
 {
-	return edenFinal;
+	QVector<GraphPoisson> graphs;
+	for (const GraphColumn<double>& c : edenFinal)
+		graphs.append(c.ToGraph(Z));
+	return graphs;
 }
 
 void IsoVectoGenerationV3::PreProcess()
@@ -88,7 +100,7 @@ void IsoVectoGenerationV3::PreProcess()
 	// RAZ
 	nbAssigned = 0;
 	lastChosen = -1;
-	R = GraphPoisson(Z, INITIAL_VALUE);
+	R = GraphColumn<int>(Z, INITIAL_STEP);
 	idZones.clear();
 	edenAsc.clear();
 	edenDesc.clear();
@@ -124,8 +136,8 @@ void IsoVectoGenerationV3::PostProcess()
 
 void IsoVectoGenerationV3::CreateBorders()
 {
-	internalBorders.clear();
-	externalBorders.clear();
+	internalBorders = EdenFrontier(Z.Size());
+	externalBorders = EdenFrontier(Z.Size());
 	currentZoneNodes.clear();
 
 	// On assigne directement les lments proche de la cote
@@ -142,47 +154,56 @@ void IsoVectoGenerationV3::CreateBorders()
 	{
 		// Un membre de la zone ne peut pas se situer sur une bordure ds le dbut
 		// Il est possible que le noeud soit de la zone, mais soit dj assign (dans R donc) s'il tait sur la bordure, donc on ne veut pas le rassigner.
-		if (Z[nodeId] == currentZone && R[nodeId] == INITIAL_VALUE)
+		if (Z[nodeId] == currentZone && R[nodeId] == INITIAL_STEP)
 		{
 			currentZoneNodes.insert(nodeId);
 			TLow[nodeId] = NOT_INIT_ZONE_VALUE;
 			THigh[nodeId] = NOT_INIT_ZONE_VALUE;
 			T[nodeId] = NOT_INIT_ZONE_VALUE;
 			R[nodeId] = NOT_INIT_ZONE_VALUE;
+			internalBorders.SetFree(nodeId);
+			externalBorders.SetFree(nodeId);
 		}
-		// Les bordures sont les lments des zones externes qui sont au bord d'un lment de la zone actuelle
 		else
 		{
-			TLow[nodeId] = INITIAL_VALUE;
-			THigh[nodeId] = INITIAL_VALUE;
+			TLow[nodeId] = INITIAL_STEP;
+			THigh[nodeId] = INITIAL_STEP;
 			T[nodeId] = INITIAL_VALUE;
-			for (int neighId : Z.Neighbours(nodeId))
-			{
-				if (Z[neighId] == currentZone && (R[neighId] == INITIAL_VALUE || R[neighId] == NOT_INIT_ZONE_VALUE))
-				{
-					if (Z[nodeId] > currentZone)
-						internalBorders.insert(nodeId);
-					else
-						externalBorders.insert(nodeId);
-				}
-			}
 		}
 	}
 
+	// Les bordures sont les lments des zones externes qui sont au bord d'un lment de la zone actuelle
+	// Un noeud n'entre dans une bordure que s'il a au moins un voisin libre
+	for (int nodeId = 0; nodeId < Z.Size(); ++nodeId)
+	{
+		if (R[nodeId] == NOT_INIT_ZONE_VALUE)
+			continue;
+
+		if (Z[nodeId] > currentZone)
+			internalBorders.AddBorder(Z, nodeId, BorderWeight(nodeId, true));
+		else
+			externalBorders.AddBorder(Z, nodeId, BorderWeight(nodeId, false));
+	}
+
 	// To keep all nodes in the zone directly neighbouring the external borders (possible growth from these elements)
-	accessibleElements.clear();
-	for (int nodeId : externalBorders)
+	// T is not known yet, they are only marked here and pushed in the heap in FinalNodesAssignments
+	accessibleElements = {};
+	accessible = QVector<bool>(Z.Size(), false);
+	for (int nodeId = 0; nodeId < Z.Size(); ++nodeId)
 	{
+		if (!externalBorders.Contains(nodeId))
+			continue;
+
 		for (int neighId : Z.Neighbours(nodeId))
 		{
 			if (R[neighId] == NOT_INIT_ZONE_VALUE)
 			{
-				accessibleElements.insert(neighId);
+				accessible[neighId] = true;
 			}
 		}
 	}
 
-	if (internalBorders.empty() && externalBorders.empty())
+	if (internalBorders.IsEmpty() && externalBorders.IsEmpty())
 	{
 		cerr << "[Version 3] No border in the Eden. Impossible to grow for zone " << currentZone << " without border." << endl;
 	}
@@ -229,15 +250,15 @@ void IsoVectoGenerationV3::DoubleEdenNodesAssignments()
 		}
 		else if (!containsDesc)
 		{
-			T[nodeId] = TLow[nodeId] / sizeZone;
+			T[nodeId] = double(TLow[nodeId]) / sizeZone;
 		}
 		else if (!containsAsc)
 		{
-			T[nodeId] = (sizeZone - THigh[nodeId]) / sizeZone;
+			T[nodeId] = double(sizeZone - THigh[nodeId]) / sizeZone;
 		}
 		else
 		{
-			T[nodeId] = TLow[nodeId] / (TLow[nodeId] + THigh[nodeId]);
+			T[nodeId] = double(TLow[nodeId]) / (TLow[nodeId] + THigh[nodeId]);
 		}
 	}
 
@@ -248,49 +269,28 @@ void IsoVectoGenerationV3::DoubleEdenNodesAssignments()
 
 bool IsoVectoGenerationV3::DoubleEdenChooseNextNode(int valueToGive, bool internal)
 {
-	QSet<int>& borders = internal ? internalBorders : externalBorders;
-	GraphPoisson& Zone = internal ? THigh : TLow;
+	EdenFrontier& borders = internal ? internalBorders : externalBorders;
+	GraphColumn<int>& Zone = internal ? THigh : TLow;
 
-	static Random r;
-	while (true)
-	{
-		// On rcupre un lment de bordure (on inverse les proba si on vient de l'intrieur (phase descendante)
-		int parent = GetRandomNode(borders, internal);
+	// On rcupre un lment de bordure (on inverse les proba si on vient de l'intrieur (phase descendante)
+	int parent = GetRandomNode(borders);
 
-		// Certaines zones n'ont pas de bordures internes (isos de pics)
-		// Certaines zones n'ont pas de bordures externes (isos endorique)
-		// Donc il est possible qu'on ne puisse plus grossir
-		if (parent == -1)
-		{
-			return false;
-		}
+	// Certaines zones n'ont pas de bordures internes (isos de pics)
+	// Certaines zones n'ont pas de bordures externes (isos endorique)
+	// Donc il est possible qu'on ne puisse plus grossir
+	if (parent == -1)
+	{
+		return false;
+	}
 
-		// On choisit un des voisins de manire alatoire
-		QVector<int> neighs;
-		for (int neigh : Z.Neighbours(parent))
-		{
-			if (Zone[neigh] == NOT_INIT_ZONE_VALUE)
-			{
-				neighs.append(neigh);
-			}
-		}
+	// On choisit un des voisins non assigns de manire alatoire
+	// Un noeud est dans la bordure tant qu'il a au moins un voisin non choisi, il en a donc forcment un
+	lastChosen = borders.FreeNeighbour(Z, parent, neighbourRandom.Integer(borders.FreeNeighbours(parent)));
+	Zone[lastChosen] = valueToGive;
 
-		// Un noeud est dans la bordure s'il a au moins un voisin non choisi
-		// On enlve un noeud de l'ensemble des bordures que lorsqu'on le choisi alatoirement et qu'on se rend compte que tous les voisins sont choisis
-		// TODO: c'est sans doute plus rapide de garder le set le plus petit possible  chaque fois, mais c'est plus clair et plus rapide  coder comme a
-		if (!neighs.empty())
-		{
-			lastChosen = neighs[r.Integer(neighs.size())];
-			borders.insert(lastChosen);
-			Zone[lastChosen] = valueToGive;
-			return true;
-		}
-		else
-		{
-			// On n'est plus dans la bordure si on n'a plus de voisin
-			borders.remove(parent);
-		}
-	}
+	// Met  jour uniquement les voisins de lastChosen (ils sortent de la bordure s'ils n'ont plus de voisin libre)
+	borders.Assign(Z, lastChosen, BorderWeight(lastChosen, internal));
+	return true;
 }
 
 void IsoVectoGenerationV3::FinalNodesAssignments()
@@ -317,6 +317,12 @@ void IsoVectoGenerationV3::FinalNodesAssignments()
 	// On assigne selon l'ordre de T, mais seulement en fonction des lments de T proche de la bordure actuelle
 	else
 	{
+		for (int nodeId : currentZoneNodes)
+		{
+			if (accessible[nodeId])
+				accessibleElements.push({ T[nodeId], nodeId });
+		}
+
 		for (int i = 0; i < sizeZone; ++i)
 		{
 			if (!FinalChooseNextNode())
@@ -345,78 +351,61 @@ void IsoVectoGenerationV3::FinalNodesAssignments()
 
 bool IsoVectoGenerationV3::FinalChooseNextNode()
 {
-	if (accessibleElements.empty())
+	// Suppression paresseuse des lments dj assigns
+	while (!accessibleElements.empty() && R[accessibleElements.top().second] != NOT_INIT_ZONE_VALUE)
 	{
-		return false;
+		accessibleElements.pop();
 	}
 
-	// On rcupre l'lment de la bordure  valeur la plus basse (PAS DE PROBA)
-	lastChosen = *accessibleElements.begin();
-	double smallest = T[lastChosen];
-	for (int p : accessibleElements)
+	if (accessibleElements.empty())
 	{
-		if (T[p] < smallest)
-		{
-			lastChosen = p;
-			smallest = T[p];
-		}
+		return false;
 	}
 
+	// On rcupre l'lment de la bordure  valeur la plus basse (PAS DE PROBA),  galit le plus petit indice
+	lastChosen = accessibleElements.top().second;
+	accessibleElements.pop();
+
 	// Tous les voisins non assigns deviennent des lments accessibles
 	for (int neigh : Z.Neighbours(lastChosen))
 	{
-		if (R[neigh] == NOT_INIT_ZONE_VALUE)
+		if (R[neigh] == NOT_INIT_ZONE_VALUE && !accessible[neigh])
 		{
-			accessibleElements.insert(neigh);
+			accessible[neigh] = true;
+			accessibleElements.push({ T[neigh], neigh });
 		}
 	}
 
-	accessibleElements.remove(lastChosen);
 	R[lastChosen] = GetNextHeight();
 
 	// Permet juste de faire une animation pour chaque choix
 	if (debug > 0 && nbAssigned % debug == 0)
-		ArticleUtils::ArticleGif(R, lastChosen, root);
+		ArticleUtils::ArticleGif(R.ToGraph(Z), lastChosen, root);
 
 	return true;
 }
 
-// Renvoie un noeud alatoire, en fonction des bordures donnes. On inverse lorsqu'on part de la bordure externe pour que les probas signifient la meme chose
-int IsoVectoGenerationV3::GetRandomNode(const QSet<int>& borders, bool inverseProba)
+// Renvoie un noeud alatoire, en fonction des bordures donnes (en O(log n) grce  l'arbre des sommes)
+int IsoVectoGenerationV3::GetRandomNode(const EdenFrontier& borders)
 {
-	static Random r = Random::R239;
-	double cumul = 0;
-	for (int ind : borders)
-	{
-		// TODO: normalement les probas vont de 0  1, donc c'est plus simple de faire a pour inverser les probas, mais ptetre faire diffremment
-		if (inverseProba) cumul += 1 - P[ind];
-		else			  cumul += P[ind];
-	}
-
 	// Si aucun point ne peut tre choisi, on n'en choisi pas
-	if (cumul == 0)
+	if (borders.IsEmpty())
 		return -1;
 
-	double p = r.Uniform(0, cumul);
-	for (int ind : borders)
-	{
-		if (inverseProba) p -= 1 - P[ind];
-		else			  p -= P[ind];
-
-		if (p <= 0)
-		{
-			//if (cumul < 1)
-				//cout << cumul << " node " << ind << endl;
-			return ind;
-		}
-	}
+	return borders.Sample(nodeRandom.Uniform(0, borders.Total()));
+}
 
-	std::cerr << "PROBLEM" << std::endl;
-	return 0;
+// Poids d'un noeud dans une bordure. On inverse lorsqu'on part de la bordure interne pour que les probas signifient la meme chose
+double IsoVectoGenerationV3::BorderWeight(int nodeId, bool inverseProba) const
+{
+	// TODO: normalement les probas vont de 0  1, donc c'est plus simple de faire a pour inverser les probas, mais ptetre faire diffremment
+	if (inverseProba)
+		return 1 - P[nodeId];
+	return P[nodeId];
 }
 
 // Should only be called when we set the height of a node
-double IsoVectoGenerationV3::GetNextHeight()
+int IsoVectoGenerationV3::GetNextHeight()
 {
 	return nbAssigned++;
 }
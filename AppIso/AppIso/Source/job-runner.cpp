@@ -0,0 +1,54 @@
+#include "job-runner.h"
+
+/*!
+\brief Report the progress of the job, the receiver gets it through its event loop (nothing is reported once the job is cancelled)
+*/
+void JobRunner::Control::SetProgress(int percent) const
+{
+    if (!progress || IsCancelled())
+        return;
+
+    std::shared_ptr<std::atomic<bool>> flag = cancelled;
+    std::function<void(int)> callback = progress;
+    QMetaObject::invokeMethod(receiver, [flag, callback, percent]() {
+        if (!*flag)
+            callback(percent);
+    }, Qt::QueuedConnection);
+}
+
+JobRunner::JobRunner(QObject* receiver) : receiver(receiver)
+{
+}
+
+/*!
+\brief Cancel the last job and wait for every worker thread
+The results still waiting in the event loop of the receiver are dropped with it.
+*/
+JobRunner::~JobRunner()
+{
+    current.Cancel();
+    for (QThread* thread : threads)
+    {
+        thread->wait();
+        delete thread;
+    }
+}
+
+/*!
+\brief Return true while a worker thread is running, including superseded jobs which have not noticed their cancellation yet
+*/
+bool JobRunner::IsBusy() const
+{
+    return !threads.isEmpty();
+}
+
+void JobRunner::Start(std::function<void()> work)
+{
+    QThread* thread = QThread::create(work);
+    threads.append(thread);
+    QObject::connect(thread, &QThread::finished, receiver, [this, thread]() {
+        threads.removeOne(thread);
+        thread->deleteLater();
+    });
+    thread->start();
+}
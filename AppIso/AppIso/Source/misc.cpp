@@ -2,24 +2,34 @@
 #include "sampling.h"
 #include "tin.h"
 
-/*
- * Fait un DiskSampling delaunays  l'intrieur de box
- */
-Mesh2 Misc::DelaunayPointsInBox(const Box2& box, double r)
+#include <QtCore/QMutex>
+#include <tuple>
+
+/*!
+\brief Poisson tile DiscTileLinked(n, r, k) and its triangles, computed once per set of parameters
+The tile does not depend on the box nor on the radius asked to DelaunayPointsInBox (it is only scaled), so every graph reuses it.
+*/
+const Misc::PoissonTile& Misc::CachedPoissonTile(int n, double r, int k)
 {
-	// TODO use a precomputed one
-	DiscTileLinked sample(70, 1, 10000);
+	static QMutex mutex;
+	static QMap<std::tuple<int, double, int>, QSharedPointer<const PoissonTile>> tiles;
 
-	double ratio = r / sample.Radius();
-	sample.Scale(ratio);
+	// Les graphes peuvent tre construits depuis plusieurs threads
+	QMutexLocker lock(&mutex);
+	std::tuple<int, double, int> key(n, r, k);
+	if (tiles.contains(key))
+		return *tiles[key];
+
+	QSharedPointer<PoissonTile> tile(new PoissonTile{ DiscTileLinked(n, r, k), {} });
+	const DiscTileLinked& sample = tile->sample;
+	QVector<QPoint>& pointIndices = tile->triangles;
 
 	// Get all triangles of the sample
 	// attention la technique ne marche pas si on peut faire une boucle de 3 sommets qui n'est pas un triangle dans le sample
 	// a priori a m'arrive que si le sample est trop petit
-	QVector<QPoint> pointIndices;
-	int n = sample.Size();
+	int size = sample.Size();
 
-	for (int ind = 0; ind < n; ++ind)
+	for (int ind = 0; ind < size; ++ind)
 	{
 		QPoint pi1(ind, 8);
 		for (int neigh1 = 0; neigh1 < sample.Valence(ind); ++neigh1)
@@ -57,6 +67,42 @@ Mesh2 Misc::DelaunayPointsInBox(const Box2& box, double r)
 		}
 	}
 
+	tiles[key] = tile;
+	return *tile;
+}
+
+/*
+ * Fait un DiskSampling delaunays  l'intrieur de box
+ */
+Mesh2 Misc::DelaunayPointsInBox(const Box2& box, double r)
+{
+	return DelaunayPointsInTiles(box, r, nullptr, 0);
+}
+
+/*
+ * Mme chose, mais seules les tuiles  moins de margin d'un point du masque non nul sont remplies (et celles qui relient les les, voir FillTiles)
+ * La mmoire dpend de la surface des terres et plus de celle de la box, ce qui compte pour les archipels
+ */
+Mesh2 Misc::DelaunayPointsInBox(const Box2& box, double r, const ScalarField2& mask, double margin)
+{
+	return DelaunayPointsInTiles(box, r, &mask, margin);
+}
+
+/*
+ * Rplique la tuile de Poisson sur la box, en sautant les tuiles trop loin du masque quand il est donn
+ * Les sommets et les triangles sont crits directement dans les tableaux du maillage final, sans SubMesh
+ */
+Mesh2 Misc::DelaunayPointsInTiles(const Box2& box, double r, const ScalarField2* mask, double margin)
+{
+	// Tuile partage, on ne paye que sa mise  l'chelle
+	const PoissonTile& tile = CachedPoissonTile(70, 1, 10000);
+	const QVector<QPoint>& pointIndices = tile.triangles;
+	DiscTileLinked sample = tile.sample;
+
+	double ratio = r / sample.Radius();
+	sample.Scale(ratio);
+	int n = sample.Size();
+
 	// Copied from DiscTileLinked::next
 	const QPoint next[9] = { QPoint(1,0),QPoint(1,1),QPoint(0,1),QPoint(-1,1),QPoint(-1,0),QPoint(-1,-1),QPoint(0,-1),QPoint(1,-1),QPoint(0,0) };
 
@@ -69,61 +115,221 @@ Mesh2 Misc::DelaunayPointsInBox(const Box2& box, double r)
 	int nW = Math::Ceil(W / w);
 	int nH = Math::Ceil(H / w);
 
-	QVector<Vector2> points(n * nW * nH);
-	QVector<int> indices;
+	// Occupation grossire : tuiles contenant un point du masque non nul, puis dilates de margin
+	QVector<bool> keep(nW * nH, mask == nullptr);
+	if (mask != nullptr)
+	{
+		QVector<bool> land(nW * nH, false);
+		for (int x = 0; x < mask->GetSizeX(); ++x)
+		{
+			for (int y = 0; y < mask->GetSizeY(); ++y)
+			{
+				if (mask->at(x, y) <= 0)
+					continue;
+				Vector2 c = mask->ArrayVertex(x, y);
+				int i = int(floor((c[0] - box[0][0]) / w));
+				int j = int(floor((c[1] - box[0][1]) / w));
+				if (i >= 0 && i < nW && j >= 0 && j < nH)
+					land[i * nH + j] = true;
+			}
+		}
+
+		// Un sommet de Poisson peut tre  une cellule du masque du premier point de terre
+		Box2 mb = mask->GetBox();
+		double cell = Math::Max((mb[1][0] - mb[0][0]) / Math::Max(1, mask->GetSizeX() - 1), (mb[1][1] - mb[0][1]) / Math::Max(1, mask->GetSizeY() - 1));
+		int k = int(Math::Ceil((margin + 2 * cell) / w));
+		for (int i = 0; i < nW; ++i)
+		{
+			for (int j = 0; j < nH; ++j)
+			{
+				if (!land[i * nH + j])
+					continue;
+				for (int di = Math::Max(0, i - k); di <= Math::Min(nW - 1, i + k); ++di)
+					for (int dj = Math::Max(0, j - k); dj <= Math::Min(nH - 1, j + k); ++dj)
+						keep[di * nH + dj] = true;
+			}
+		}
 
+		FillTiles(keep, nW, nH);
+	}
+
+	// Place de chaque tuile garde dans les tableaux (-1 si elle est saute)
+	QVector<int> slots(nW * nH, -1);
+	int kept = 0;
+	for (int b = 0; b < nW * nH; ++b)
+	{
+		if (keep[b])
+			slots[b] = kept++;
+	}
+
+	// Sommets : les points hors de la box ne sont pas gards (indice -1)
+	QVector<int> vertexIndex(kept * n, -1);
+	QVector<Vector2> points;
+	points.reserve(kept * n);
 	for (int i = 0; i < nW; ++i)
 	{
 		double x = box[0][0] + i * w;
 		for (int j = 0; j < nH; ++j)
 		{
-			double y = box[0][1] + j * w;
-			Vector2 t(x, y);
-			int boxInd = i * nH + j;
+			int slot = slots[i * nH + j];
+			if (slot == -1)
+				continue;
 
-			// We add n points
+			Vector2 t(x, box[0][1] + j * w);
 			for (int p = 0; p < n; ++p)
 			{
-				int ind = boxInd * n + p;
-				points[ind] = sample.Vertex(p) + t;
+				Vector2 v = sample.Vertex(p) + t;
+				if (!box.Inside(v))
+					continue;
+				vertexIndex[slot * n + p] = points.size();
+				points.append(v);
 			}
+		}
+	}
+
+	// Triangles dont les trois sommets ont t gards
+	QVector<int> indices;
+	indices.reserve(kept * pointIndices.size());
+	for (int i = 0; i < nW; ++i)
+	{
+		for (int j = 0; j < nH; ++j)
+		{
+			if (slots[i * nH + j] == -1)
+				continue;
 
-			// We also add triangles
 			for (int t = 0; t < pointIndices.size(); t += 3)
 			{
-				QPoint pi1 = pointIndices[t];
-				QPoint pi2 = pointIndices[t + 1];
-				QPoint pi3 = pointIndices[t + 2];
+				int ind[3];
+				bool inside = true;
+				for (int k = 0; k < 3 && inside; ++k)
+				{
+					QPoint pi = pointIndices[t + k];
+					QPoint tk = QPoint(i, j) + next[pi.y()];
+					if (tk.x() < 0 || tk.x() >= nW || tk.y() < 0 || tk.y() >= nH)
+					{
+						inside = false;
+						break;
+					}
+					int slot = slots[tk.x() * nH + tk.y()];
+					ind[k] = slot == -1 ? -1 : vertexIndex[slot * n + pi.x()];
+					inside = ind[k] != -1;
+				}
+				if (!inside)
+					continue;
 
-				QPoint tile1 = QPoint(i, j) + next[pi1.y()];
-				QPoint tile2 = QPoint(i, j) + next[pi2.y()];
-				QPoint tile3 = QPoint(i, j) + next[pi3.y()];
+				indices.append(ind[0]);
+				indices.append(ind[1]);
+				indices.append(ind[2]);
+			}
+		}
+	}
 
-				if (tile1.x() < 0 || tile1.x() >= nW || tile1.y() < 0 || tile1.y() >= nH)
-					continue;
-				if (tile2.x() < 0 || tile2.x() >= nW || tile2.y() < 0 || tile2.y() >= nH)
-					continue;
-				if (tile3.x() < 0 || tile3.x() >= nW || tile3.y() < 0 || tile3.y() >= nH)
-					continue;
+	return Mesh2(points, indices);
+}
 
-				int ind1 = (tile1.x() * nH + tile1.y()) * n + pi1.x();
-				int ind2 = (tile2.x() * nH + tile2.y()) * n + pi2.x();
-				int ind3 = (tile3.x() * nH + tile3.y()) * n + pi3.x();
+/*
+ * Complte les tuiles gardes pour que le maillage soit d'un seul tenant, sans trou ni point d'articulation
+ * Le Tin2 construit sur topologyExt ne gre ni les trous, ni plusieurs composantes (la liste des voisins du point infini serait corrompue), ni les points d'articulation
+ *
+ * Chaque colonne de tuiles devient un intervalle (plus de trou), les colonnes vides entre deux les reoivent une tuile qui fait le pont,
+ * et deux colonnes voisines partagent au moins une tuile (pas de tuiles qui ne se touchent que par un coin)
+ *
+ * \param keep Tuiles gardes, indice i * nH + j
+ */
+void Misc::FillTiles(QVector<bool>& keep, int nW, int nH)
+{
+	// Intervalle [lo, hi] des tuiles gardes de chaque colonne, lo > hi si elle est vide
+	QVector<int> lo(nW, nH), hi(nW, -1);
+	int first = -1, last = -1;
+	for (int i = 0; i < nW; ++i)
+	{
+		for (int j = 0; j < nH; ++j)
+		{
+			if (!keep[i * nH + j])
+				continue;
+			lo[i] = Math::Min(lo[i], j);
+			hi[i] = Math::Max(hi[i], j);
+		}
+		if (lo[i] <= hi[i])
+		{
+			if (first == -1)
+				first = i;
+			last = i;
+		}
+	}
+	if (first == -1)
+		return;
 
-				indices.append(ind1);
-				indices.append(ind2);
-				indices.append(ind3);
-			}
+	for (int i = first; i < last; ++i)
+	{
+		// Colonne vide entre deux les : une tuile au milieu de la prcdente
+		if (lo[i + 1] > hi[i + 1])
+		{
+			lo[i + 1] = hi[i + 1] = (lo[i] + hi[i]) / 2;
+			continue;
 		}
+
+		// On agrandit la colonne i jusqu' toucher la suivante par un ct
+		if (hi[i] < lo[i + 1])
+			hi[i] = lo[i + 1];
+		if (lo[i] > hi[i + 1])
+			lo[i] = hi[i + 1];
+	}
+
+	for (int i = first; i <= last; ++i)
+	{
+		for (int j = lo[i]; j <= hi[i]; ++j)
+			keep[i * nH + j] = true;
+	}
+}
+
+/*
+ * Sous-maillage des sommets o le masque est non nul, et des triangles dont les trois sommets sont gards
+ * Contrairement  Mesh2::SubMesh, la correspondance des indices est donne directement : pas besoin de IndicesBetweenMeshes
+ *
+ * \param mesh The complete mesh
+ * \param mask Vertices where the mask is 0 (or outside its box) are removed
+ * \param subToMesh For each vertex of the submesh, its index in mesh
+ * \param meshToSub For each vertex of mesh, its index in the submesh (-1 if removed)
+ */
+Mesh2 Misc::SubMesh(const Mesh2& mesh, const ScalarField2& mask, QVector<int>& subToMesh, QVector<int>& meshToSub)
+{
+	Box2 box = mask.GetBox();
+	int n = mesh.VertexSize();
+	meshToSub.fill(-1, n);
+	subToMesh.clear();
+
+	QVector<Vector2> points;
+	for (int i = 0; i < n; ++i)
+	{
+		Vector2 p = mesh.Vertex(i);
+		if (!box.Inside(p) || mask.Value(p) <= 0)
+			continue;
+		meshToSub[i] = points.size();
+		subToMesh.append(i);
+		points.append(p);
 	}
 
-	return Mesh2(points, indices).SubMesh(box);
+	QVector<int> indices;
+	for (int t = 0; t < mesh.TriangleSize(); ++t)
+	{
+		int a = meshToSub[mesh.index(t, 0)];
+		int b = meshToSub[mesh.index(t, 1)];
+		int c = meshToSub[mesh.index(t, 2)];
+		if (a == -1 || b == -1 || c == -1)
+			continue;
+		indices.append(a);
+		indices.append(b);
+		indices.append(c);
+	}
+
+	return Mesh2(points, indices);
 }
 
 /*
  * When two mesh are submeshes, indices completly change
  * This function allows one to get the matching of one mesh indices to the other
- * O(n) amorti
+ * O(n), the vertices of m1 are bucketed in a flat hashed grid of cells of size mindist (counting sort, no per cell allocation)
  * 
  * \param m1 The mesh we have indices
  * \param m2 The mesh we want to have correlation
@@ -134,52 +340,62 @@ Mesh2 Misc::DelaunayPointsInBox(const Box2& box, double r)
 QVector<int> Misc::IndicesBetweenMeshes(const Mesh2& m1, const Mesh2& m2, const double& mindist)
 {
 	QVector<int> match(m1.VertexSize(), -1);
-	QMap<QPair<int, int>, QVector<int>> map;
+	int n1 = m1.VertexSize();
+	if (n1 == 0)
+		return match;
+
+	// On construit des cases de taille mindist/mindist, ranges dans une table de hachage de taille ~ n1 : la mmoire ne dpend pas de la box
+	// Deux cases peuvent tomber dans la mme entre, ce n'est pas grave car on vrifie la distance
+	int size = 1;
+	while (size < n1)
+		size *= 2;
+	auto bucket = [size](int x, int y) {
+		return int((uint(x) * 73856093u ^ uint(y) * 19349663u) & uint(size - 1));
+	};
 
-	// On construit des cases de taille mindist/mindist
-	for (int vi1 = 0; vi1 < m1.VertexSize(); ++vi1)
+	// Tri par dnombrement : les sommets de l'entre c sont sorted[offsets[c], offsets[c + 1]), dans l'ordre des indices
+	QVector<int> cells(n1);
+	QVector<int> offsets(size + 1, 0);
+	for (int vi1 = 0; vi1 < n1; ++vi1)
 	{
 		Vector2 v1 = m1.Vertex(vi1);
-		int first = (int) v1[0] / mindist;
-		int second = (int) v1[1] / mindist;
-
-		QPair<int, int> p(first, second);
-		if (!map.contains(p))
-			map[p] = {};
-		map[p].append(vi1);
+		cells[vi1] = bucket(int(floor(v1[0] / mindist)), int(floor(v1[1] / mindist)));
+		offsets[cells[vi1] + 1]++;
 	}
+	for (int c = 0; c < size; ++c)
+		offsets[c + 1] += offsets[c];
+
+	QVector<int> sorted(n1);
+	QVector<int> fill = offsets;
+	for (int vi1 = 0; vi1 < n1; ++vi1)
+		sorted[fill[cells[vi1]]++] = vi1;
 
 	// On cherche le sommet le plus proche dans la case et les cases adjacentes
 	for (int vi2 = 0; vi2 < m2.VertexSize(); ++vi2)
 	{
 		Vector2 v2 = m2.Vertex(vi2);
-		int first = (int) v2[0] / mindist;
-		int second = (int) v2[1] / mindist;
+		int first = int(floor(v2[0] / mindist));
+		int second = int(floor(v2[1] / mindist));
 		bool find = false;
 
 		int checkDist = 1;
 
-		for (int x = first - checkDist; x <= first + checkDist; ++x)
+		for (int x = first - checkDist; x <= first + checkDist && !find; ++x)
 		{
-			for (int y = second - checkDist; y <= second + checkDist; ++y)
+			for (int y = second - checkDist; y <= second + checkDist && !find; ++y)
 			{
-				QPair<int, int> p(x, y);
-				if (map.contains(p))
+				int c = bucket(x, y);
+				for (int k = offsets[c]; k < offsets[c + 1]; ++k)
 				{
-					for (int vi1 : map[p])
+					int vi1 = sorted[k];
+					if (Norm(m1.Vertex(vi1) - v2) < mindist)
 					{
-						Vector2 v1 = m1.Vertex(vi1);
-						if (Norm(v1 - v2) < mindist)
-						{
-							match[vi1] = vi2;
-							find = true;
-							break;
-						}
+						match[vi1] = vi2;
+						find = true;
+						break;
 					}
 				}
-				if (find) break;
 			}
-			if (find) break;
 		}
 	}
 
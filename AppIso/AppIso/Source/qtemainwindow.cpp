@@ -112,7 +112,7 @@ void MainAmplificationWindow::CreateActions()
 	connect(m_uiw.mask_button, &QPushButton::clicked, this, &MainAmplificationWindow::BrowseMask);
 	connect(m_uiw.mask_from_view_isos_button, &QPushButton::clicked, this, &MainAmplificationWindow::ChangeMaskFromCurrentIsos);
 
-	connect(m_uiw.generation_button, &QPushButton::clicked, this, [this]() { Generate(3); });
+	connect(m_uiw.generation_button, &QPushButton::clicked, this, [this]() { GenerateInBackground(3); });
 
 	ResetGenBox();
 	ChangeHistogramFromFile(m_histogram_directory + "reunion.png", 12);
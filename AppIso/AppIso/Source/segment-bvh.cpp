@@ -0,0 +1,210 @@
+#include "segment-bvh.h"
+
+/*!
+\brief Build the hierarchy on the edges of the polygon (the last vertex is linked to the first one)
+*/
+SegmentBVH::SegmentBVH(const Polygon2& poly)
+{
+    int n = poly.Size();
+    if (n < 2)
+        return;
+
+    a.reserve(n);
+    b.reserve(n);
+    for (int i = 0; i < n; ++i)
+    {
+        a.append(poly.Vertex(i));
+        b.append(poly.Vertex((i + 1) % n));
+    }
+
+    QVector<int> order(n);
+    for (int i = 0; i < n; ++i)
+        order[i] = i;
+
+    nodes.reserve(n);
+    nodes.append(Node());
+    Build(0, 0, n, order);
+
+    // Segments of a leaf are contiguous
+    QVector<Vector2> sa(n), sb(n);
+    for (int i = 0; i < n; ++i)
+    {
+        sa[i] = a[order[i]];
+        sb[i] = b[order[i]];
+    }
+    a = sa;
+    b = sb;
+}
+
+/*!
+\brief Recursively fill node id with the segments order[first, last)
+
+Segments are split at the median of their centers along the longest side of the box, leaves have at most 4 segments.
+*/
+void SegmentBVH::Build(int id, int first, int last, QVector<int>& order)
+{
+    Node node;
+    node.xmin = node.ymin = Math::Infinity;
+    node.xmax = node.ymax = -Math::Infinity;
+    for (int k = first; k < last; ++k)
+    {
+        int i = order[k];
+        node.xmin = Math::Min(node.xmin, Math::Min(a[i][0], b[i][0]));
+        node.ymin = Math::Min(node.ymin, Math::Min(a[i][1], b[i][1]));
+        node.xmax = Math::Max(node.xmax, Math::Max(a[i][0], b[i][0]));
+        node.ymax = Math::Max(node.ymax, Math::Max(a[i][1], b[i][1]));
+    }
+
+    if (last - first <= 4)
+    {
+        node.first = first;
+        node.count = last - first;
+        nodes[id] = node;
+        return;
+    }
+
+    int axis = (node.xmax - node.xmin) > (node.ymax - node.ymin) ? 0 : 1;
+    int mid = (first + last) / 2;
+    std::nth_element(order.begin() + first, order.begin() + mid, order.begin() + last, [this, axis](int i, int j) {
+        return a[i][axis] + b[i][axis] < a[j][axis] + b[j][axis];
+    });
+
+    node.left = nodes.size();
+    nodes[id] = node;
+    nodes.append(Node());
+    nodes.append(Node());
+    Build(node.left, first, mid, order);
+    Build(node.left + 1, mid, last, order);
+}
+
+/*!
+\brief Distance between a point and the polygon boundary
+\param p The point
+\param bound If the distance is bigger than bound, the search stops as soon as it is sure and returns a value >= bound
+*/
+double SegmentBVH::Distance(const Vector2& p, double bound) const
+{
+    if (nodes.isEmpty())
+        return bound;
+
+    double best = bound * bound;
+    int stack[64];
+    int top = 0;
+    stack[top++] = 0;
+
+    while (top > 0)
+    {
+        const Node& node = nodes[stack[--top]];
+        if (SquaredDistance(node, p) >= best)
+            continue;
+
+        if (node.left == -1)
+        {
+            for (int i = node.first; i < node.first + node.count; ++i)
+            {
+                // Distance to the segment [a, b]
+                double ux = b[i][0] - a[i][0];
+                double uy = b[i][1] - a[i][1];
+                double vx = p[0] - a[i][0];
+                double vy = p[1] - a[i][1];
+                double l = ux * ux + uy * uy;
+                double t = l > 0 ? Math::Min(1.0, Math::Max(0.0, (ux * vx + uy * vy) / l)) : 0.0;
+                double dx = vx - t * ux;
+                double dy = vy - t * uy;
+                best = Math::Min(best, dx * dx + dy * dy);
+            }
+            continue;
+        }
+
+        // The closest child is visited first, it often allows to skip the other one
+        int near = node.left;
+        int far = node.left + 1;
+        if (SquaredDistance(nodes[far], p) < SquaredDistance(nodes[near], p))
+            std::swap(near, far);
+        stack[top++] = far;
+        stack[top++] = near;
+    }
+
+    return sqrt(best);
+}
+
+/*!
+\brief Check if a point is inside the polygon, by counting the edges crossed by the half line going to +x
+*/
+bool SegmentBVH::Inside(const Vector2& p) const
+{
+    if (nodes.isEmpty())
+        return false;
+
+    bool inside = false;
+    int stack[64];
+    int top = 0;
+    stack[top++] = 0;
+
+    while (top > 0)
+    {
+        const Node& node = nodes[stack[--top]];
+        if (p[1] < node.ymin || p[1] > node.ymax || p[0] > node.xmax)
+            continue;
+
+        if (node.left == -1)
+        {
+            for (int i = node.first; i < node.first + node.count; ++i)
+            {
+                if ((a[i][1] > p[1]) != (b[i][1] > p[1]))
+                {
+                    double x = a[i][0] + (p[1] - a[i][1]) * (b[i][0] - a[i][0]) / (b[i][1] - a[i][1]);
+                    if (x > p[0])
+                        inside = !inside;
+                }
+            }
+            continue;
+        }
+
+        stack[top++] = node.left;
+        stack[top++] = node.left + 1;
+    }
+
+    return inside;
+}
+
+/*!
+\brief Check if the segment [sa, sb] intersects one of the edges, only the edges whose box overlaps the box of the segment are tested (with Segment2::Intersect)
+*/
+bool SegmentBVH::Intersect(const Vector2& sa, const Vector2& sb) const
+{
+    if (nodes.isEmpty())
+        return false;
+
+    Segment2 s(sa, sb);
+    double xmin = Math::Min(sa[0], sb[0]);
+    double ymin = Math::Min(sa[1], sb[1]);
+    double xmax = Math::Max(sa[0], sb[0]);
+    double ymax = Math::Max(sa[1], sb[1]);
+
+    int stack[64];
+    int top = 0;
+    stack[top++] = 0;
+
+    while (top > 0)
+    {
+        const Node& node = nodes[stack[--top]];
+        if (xmax < node.xmin || xmin > node.xmax || ymax < node.ymin || ymin > node.ymax)
+            continue;
+
+        if (node.left == -1)
+        {
+            for (int i = node.first; i < node.first + node.count; ++i)
+            {
+                if (Segment2(a[i], b[i]).Intersect(s))
+                    return true;
+            }
+            continue;
+        }
+
+        stack[top++] = node.left;
+        stack[top++] = node.left + 1;
+    }
+
+    return false;
+}
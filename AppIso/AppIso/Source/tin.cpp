@@ -4,6 +4,100 @@
 
 #include "cpu.h"
 
+// Hash map from an edge id to a triangle, used to build the TIN
+// Open addressing with linear probing in flat arrays: no allocation per edge and good locality, instead of the red-black tree of a QMap
+// Only what the constructor needs: insertion (overwrite), lookup, and operator[] which inserts 0 like QMap
+class EdgeTable
+{
+protected:
+    QVector<long long> keys;    //!< -1 for an empty slot
+    QVector<int> values;
+    int count;
+
+public:
+    EdgeTable(int);
+
+    bool Contains(long long) const;
+    int& operator[](long long);
+
+protected:
+    int Slot(long long) const;
+    void Grow();
+};
+
+/*!
+\brief Table able to store the given number of edges without growing
+*/
+EdgeTable::EdgeTable(int expected) : count(0)
+{
+    int size = 16;
+    while (size < 2 * expected)
+        size *= 2;
+    keys = QVector<long long>(size, -1);
+    values = QVector<int>(size, 0);
+}
+
+/*!
+\brief Slot of edge e, or the empty slot where it should be inserted
+*/
+inline int EdgeTable::Slot(long long e) const
+{
+    // Mixing of the bits (splitmix64 finalizer), since ids a + n * b are far from random
+    unsigned long long h = (unsigned long long)e;
+    h = (h ^ (h >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    h = (h ^ (h >> 27)) * 0x94d049bb133111ebULL;
+    h = h ^ (h >> 31);
+
+    int mask = keys.size() - 1;
+    int i = int(h & mask);
+    while (keys[i] != -1 && keys[i] != e)
+        i = (i + 1) & mask;
+    return i;
+}
+
+inline bool EdgeTable::Contains(long long e) const
+{
+    return keys[Slot(e)] == e;
+}
+
+/*!
+\brief Reference to the triangle of edge e, the edge is inserted with 0 if it was not in the table
+*/
+int& EdgeTable::operator[](long long e)
+{
+    int i = Slot(e);
+    if (keys[i] != e)
+    {
+        // Keep the table at most half full
+        if (2 * (count + 1) > keys.size())
+        {
+            Grow();
+            i = Slot(e);
+        }
+        keys[i] = e;
+        values[i] = 0;
+        count++;
+    }
+    return values[i];
+}
+
+void EdgeTable::Grow()
+{
+    QVector<long long> oldKeys = keys;
+    QVector<int> oldValues = values;
+    keys = QVector<long long>(2 * oldKeys.size(), -1);
+    values = QVector<int>(2 * oldKeys.size(), 0);
+    for (int i = 0; i < oldKeys.size(); ++i)
+    {
+        if (oldKeys[i] != -1)
+        {
+            int j = Slot(oldKeys[i]);
+            keys[j] = oldKeys[i];
+            values[j] = oldValues[i];
+        }
+    }
+}
+
 Tin2::Tin2(const Mesh2& mesh) : Mesh2(mesh)
 {
     // -1 if a vertex is not connected to any triangle
@@ -16,7 +110,7 @@ Tin2::Tin2(const Mesh2& mesh) : Mesh2(mesh)
     // The id of an edge "ab" is a + n * b where n is the number of vertices
     // Note that n*n should not be more than the size of a long long
     using edge_ind_t = long long;
-    QMap<edge_ind_t, int> edges;
+    EdgeTable edges(3 * TriangleSize());
     int n = VertexSize() + 1; // +1 considering the infinite vertex
 
     constexpr edge_ind_t lim1 = std::numeric_limits<edge_ind_t>::max();
@@ -73,7 +167,7 @@ Tin2::Tin2(const Mesh2& mesh) : Mesh2(mesh)
         edge_ind_t infp = InfinitePoint();
     
         // If the reverse id does not exist, it means that the edge is on the border of the Mesh so we create an infinite triangle
-        if (!edges.contains(e32))
+        if (!edges.Contains(e32))
         {
             infiniteIndices.append(i3);
             infiniteIndices.append(i2);
@@ -81,14 +175,14 @@ Tin2::Tin2(const Mesh2& mesh) : Mesh2(mesh)
 
             edge_ind_t e2i = i2 + infp * n;
             edge_ind_t ei3 = infp + i3 * n;
-            if (edges.contains(e2i) || edges.contains(ei3))
+            if (edges.Contains(e2i) || edges.Contains(ei3))
                 articulationPoints.insert(i1);
             edges[e32] = new_ti;
             edges[e2i] = new_ti;
             edges[ei3] = new_ti;
             new_ti++;
         }
-        if (!edges.contains(e13))
+        if (!edges.Contains(e13))
         {
             infiniteIndices.append(i1);
             infiniteIndices.append(i3);
@@ -96,14 +190,14 @@ Tin2::Tin2(const Mesh2& mesh) : Mesh2(mesh)
 
             edge_ind_t e3i = i3 + infp * n;
             edge_ind_t ei1 = infp + i1 * n;
-            if (edges.contains(e3i) || edges.contains(ei1))
+            if (edges.Contains(e3i) || edges.Contains(ei1))
                 articulationPoints.insert(i2);
             edges[e13] = new_ti;
             edges[e3i] = new_ti;
             edges[ei1] = new_ti;
             new_ti++;
         }
-        if (!edges.contains(e21))
+        if (!edges.Contains(e21))
         {
             infiniteIndices.append(i2);
             infiniteIndices.append(i1);
@@ -111,7 +205,7 @@ Tin2::Tin2(const Mesh2& mesh) : Mesh2(mesh)
 
             edge_ind_t e1i = i1 + infp * n;
             edge_ind_t ei2 = infp + i2 * n;
-            if (edges.contains(e1i) || edges.contains(ei2))
+            if (edges.Contains(e1i) || edges.Contains(ei2))
                 articulationPoints.insert(i3);
             edges[e21] = new_ti;
             edges[e1i] = new_ti;
@@ -161,11 +255,11 @@ Tin2::Tin2(const Mesh2& mesh) : Mesh2(mesh)
         edge_ind_t e32 = i3 + i2 * n;
         edge_ind_t e13 = i1 + i3 * n;
 
-        if (!edges.contains(e21))
+        if (!edges.Contains(e21))
             qDebug() << "Error: a triangle as no neighbour on one edge: this should not happend";
-        if (!edges.contains(e32))
+        if (!edges.Contains(e32))
             qDebug() << "Error: a triangle as no neighbour on one edge: this should not happend";
-        if (!edges.contains(e13))
+        if (!edges.Contains(e13))
             qDebug() << "Error: a triangle as no neighbour on one edge: this should not happend";
 
         neighbours[3 * ti] = edges[e32];
@@ -0,0 +1,79 @@
+#include "weighted-sampler.h"
+
+/*!
+\brief Create an empty set able to store indices in [0, n)
+*/
+WeightedSampler::WeightedSampler(int n) : n(n), leaves(1), size(0)
+{
+    while (leaves < n)
+        leaves *= 2;
+
+    tree = QVector<double>(2 * leaves, 0.0);
+}
+
+/*!
+\brief Remove every index from the set
+*/
+void WeightedSampler::Clear()
+{
+    tree.fill(0.0);
+    size = 0;
+}
+
+/*!
+\brief Change the weight of the leaf i and update the sums up to the root
+
+The sums are recomputed from the two children (and not incremented with the difference),
+so rounding errors do not accumulate even after millions of insertions and removals.
+*/
+void WeightedSampler::Update(int i, double w)
+{
+    int node = leaves + i;
+    double old = tree[node];
+
+    if (old > 0 && w <= 0)
+        size--;
+    else if (old <= 0 && w > 0)
+        size++;
+
+    tree[node] = w;
+    node /= 2;
+    while (node >= 1)
+    {
+        tree[node] = tree[2 * node] + tree[2 * node + 1];
+        node /= 2;
+    }
+}
+
+/*!
+\brief Return the first index for which the cumulative weight is >= u
+\param u a value in [0, Total()]
+\return the index, or -1 if the set is empty
+
+Never return an index with a null weight: we never go down into an empty subtree,
+so a u slightly bigger than Total() (rounding) simply gives the last index of the set.
+*/
+int WeightedSampler::Sample(double u) const
+{
+    if (size == 0)
+        return -1;
+
+    int node = 1;
+    while (node < leaves)
+    {
+        int left = 2 * node;
+        int right = left + 1;
+
+        if (tree[left] <= 0 || (tree[right] > 0 && u > tree[left]))
+        {
+            u -= tree[left];
+            node = right;
+        }
+        else
+        {
+            node = left;
+        }
+    }
+
+    return node - leaves;
+}